@@ -1,21 +1,205 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <string_view>
+#include <cctype>
 #include <vector>
 #include <limits>
 #include <cmath>
 #include <fstream>
+#include <array>
+#include <thread>
+#include <algorithm>
+#include <unordered_map>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <type_traits>
+#include <cstring>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <charconv>
+#include <iterator>
+#include "heatloads.h"
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 namespace core {
 
+    // Macro scripts. A recorded session is one line per answered prompt,
+    // tagged with the kind of read: "i 2", "d 1200", "s Supply air", "y" or
+    // "n". Replay feeds the reads from the script without printing prompts,
+    // and console output is muted for the run unless asked for. If a line
+    // does not fit the prompt it lands on, the replay ends and input goes
+    // back to the keyboard, the same as when the script runs out. A replay
+    // started from the command line has no keyboard to go back to, so there
+    // either way the program exits.
+    struct Macro {
+        bool recording = false;
+        std::string recordPath;
+        std::string recorded;
+        std::size_t lastStep = 0; // offset of the last recorded line
+
+        bool replaying = false;
+        std::string script;
+        std::size_t pos = 0;
+        std::size_t line = 0;
+        std::size_t steps = 0;
+        bool quitAtEnd = false;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    Macro& macro() {
+        static Macro m;
+        return m;
+    }
+
+    void record(char kind, std::string_view value = std::string_view()) {
+        Macro& m = macro();
+        if (!m.recording) return;
+        m.lastStep = m.recorded.size();
+        m.recorded += kind;
+        if (!value.empty()) {
+            m.recorded += ' ';
+            m.recorded += value;
+        }
+        m.recorded += '\n';
+    }
+
+    template <class T>
+    void recordNumber(char kind, T v) {
+        char buf[32];
+        auto r = std::to_chars(buf, buf + sizeof buf, v); // shortest form that reads back exactly
+        record(kind, std::string_view(buf, static_cast<std::size_t>(r.ptr - buf)));
+    }
+
+    // Drops the last recorded step, e.g. the menu choice that led to the
+    // macro controls.
+    void unrecordLast() {
+        Macro& m = macro();
+        if (m.recording) m.recorded.resize(m.lastStep);
+    }
+
+    bool saveRecording() {
+        Macro& m = macro();
+        m.recording = false;
+        std::ofstream out(m.recordPath, std::ios::binary);
+        if (!out) {
+            std::cout << "  ***Error*** Could not write file: " << m.recordPath << "\n";
+            return false;
+        }
+        out << "# heatloads macro 1\n" << m.recorded;
+        std::cout << "  Saved: " << m.recordPath << "\n";
+        return true;
+    }
+
+    void endReplay(const char* why = nullptr) {
+        Macro& m = macro();
+        if (!m.replaying) return;
+        m.replaying = false;
+        std::cout.clear();
+        const std::size_t done = why ? m.steps - 1 : m.steps; // a failed step is not counted
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m.started).count();
+        if (why) std::cout << "  [Error] Script line " << m.line << ": " << why << " Replay stopped.\n";
+        std::cout << "  Replayed " << done << " step(s) in " << std::fixed << std::setprecision(1) << ms << " ms.\n";
+        std::string().swap(m.script);
+    }
+
+    // Ends any replay, saves any recording and exits. Also taken when stdin
+    // closes, since every prompt after that would fail again.
+    [[noreturn]] void quit(int status = 0) {
+        endReplay();
+        if (macro().recording) saveRecording();
+        std::cout << "\nGoodbye.\n";
+        std::exit(status);
+    }
+
+    bool startReplay(const std::string& path, bool showOutput, bool quitAtEnd = false) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cout << "  ***Error*** Could not read file: " << path << "\n";
+            return false;
+        }
+        Macro& m = macro();
+        m.script.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        m.pos = 0;
+        m.line = 0;
+        m.steps = 0;
+        m.quitAtEnd = quitAtEnd;
+        m.replaying = true;
+        m.started = std::chrono::steady_clock::now();
+        if (!showOutput) std::cout.setstate(std::ios::badbit); // output calls return at once
+        return true;
+    }
+
+    // Next script step for a read of `kind`, with the value after the tag.
+    // False when not replaying; a missing or mismatched step ends the replay.
+    bool nextStep(char kind, std::string_view& value) {
+        Macro& m = macro();
+        if (!m.replaying) return false;
+        while (m.pos < m.script.size()) {
+            std::size_t end = m.script.find('\n', m.pos);
+            if (end == std::string::npos) end = m.script.size();
+            std::string_view step(m.script.data() + m.pos, end - m.pos);
+            m.pos = end + 1;
+            ++m.line;
+            if (!step.empty() && step.back() == '\r') step.remove_suffix(1);
+            if (step.empty() || step[0] == '#') continue;
+
+            const bool yn = (kind == 'y' && (step[0] == 'y' || step[0] == 'n'));
+            ++m.steps;
+            if ((step[0] != kind && !yn) || (step.size() > 1 && step[1] != ' ')) {
+                endReplay("step does not match the prompt.");
+                if (m.quitAtEnd) quit(1);
+                return false;
+            }
+            value = yn ? step.substr(0, 1) : step.substr(std::min<std::size_t>(2, step.size()));
+            return true;
+        }
+        endReplay();
+        if (m.quitAtEnd) quit();
+        return false;
+    }
+
+    // A replayed value that does not fit its prompt.
+    void badStep(const char* why) {
+        endReplay(why);
+        if (macro().quitAtEnd) quit(1);
+    }
+
+    // True once stdin has nothing more to give (end of file or a read error),
+    // as opposed to a line that merely failed to parse.
+    bool inputClosed() {
+        return std::cin.eof() || std::cin.bad();
+    }
+
     int readInt(const std::string& prompt, int minV, int maxV) {
         int v;
+        std::string_view step;
+        if (nextStep('i', step)) {
+            auto r = std::from_chars(step.data(), step.data() + step.size(), v);
+            if (r.ec == std::errc() && r.ptr == step.data() + step.size() && v >= minV && v <= maxV) return v;
+            badStep("integer out of range for the prompt.");
+        }
         while (true) {
             std::cout << prompt;
             std::cin >> v;
+            if (std::cin.fail() && inputClosed()) quit();
 
             if (!std::cin.fail() && v >= minV && v <= maxV) {
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                recordNumber('i', v);
                 return v;
             }
 
@@ -27,12 +211,20 @@ namespace core {
 
     double readDouble(const std::string& prompt, double minV, double maxV) {
         double v;
+        std::string_view step;
+        if (nextStep('d', step)) {
+            auto r = std::from_chars(step.data(), step.data() + step.size(), v);
+            if (r.ec == std::errc() && r.ptr == step.data() + step.size() && v >= minV && v <= maxV) return v;
+            badStep("number out of range for the prompt.");
+        }
         while (true) {
             std::cout << prompt;
             std::cin >> v;
+            if (std::cin.fail() && inputClosed()) quit();
 
             if (!std::cin.fail() && v >= minV && v <= maxV) {
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                recordNumber('d', v);
                 return v;
             }
 
@@ -43,24 +235,31 @@ namespace core {
     }
 
     std::string readLine(const std::string& prompt) {
+        std::string_view step;
+        if (nextStep('s', step)) return std::string(step);
         std::cout << prompt;
         std::string s;
-        std::getline(std::cin, s);
+        if (!std::getline(std::cin, s)) quit();
+        record('s', s);
         return s;
     }
 
     bool yesNo(const std::string& prompt) {
+        std::string_view step;
+        if (nextStep('y', step)) return step == "y";
         while (true) {
             std::cout << prompt << " (y/n): ";
             std::string s;
-            std::getline(std::cin, s);
-            if (s == "y" || s == "Y") return true;
-            if (s == "n" || s == "N") return false;
+            if (!std::getline(std::cin, s)) quit();
+            if (s == "y" || s == "Y") { record('y'); return true; }
+            if (s == "n" || s == "N") { record('n'); return false; }
             std::cout << "  [Error] Please type y or n.\n";
         }
     }
 
+    // Not a step: replay runs straight through, and recording skips it.
     void pause() {
+        if (macro().replaying) return;
         std::cout << "\nPress Enter to continue...";
         std::cin.get();
     }
@@ -71,187 +270,4212 @@ namespace units {
     constexpr double BTU_PER_HR_PER_KW = 3412; // 1 kW = 3412.142 BTU/hr
     constexpr double BTU_PER_HR_PER_TON = 12000.0; // 1 refrigeration ton = 12,000 BTU/hr
 
-    double btuhr_to_kw(double btuhr) { return btuhr / BTU_PER_HR_PER_KW; }
-    double kw_to_btuhr(double kw) { return kw * BTU_PER_HR_PER_KW; }
-    double btuhr_to_ton(double btuhr) { return btuhr / BTU_PER_HR_PER_TON; }
-    double ton_to_btuhr(double ton) { return ton * BTU_PER_HR_PER_TON; }
+    // A double tagged with its unit. Quantities of different units do not mix,
+    // so a swapped CFM/dT argument is a compile error. The wrapper is a single
+    // double with no vtable or padding, so arrays and loops over it compile to
+    // the same code as raw doubles.
+    template <class Tag>
+    struct Quantity {
+        double value = 0.0;
+
+        constexpr Quantity() = default;
+        constexpr explicit Quantity(double v) : value(v) {}
+
+        constexpr Quantity operator+(Quantity o) const { return Quantity(value + o.value); }
+        constexpr Quantity operator-(Quantity o) const { return Quantity(value - o.value); }
+        constexpr Quantity operator-() const { return Quantity(-value); }
+        constexpr Quantity operator*(double k) const { return Quantity(value * k); }
+        constexpr Quantity operator/(double k) const { return Quantity(value / k); }
+        constexpr double operator/(Quantity o) const { return value / o.value; }
+
+        Quantity& operator+=(Quantity o) { value += o.value; return *this; }
+        Quantity& operator-=(Quantity o) { value -= o.value; return *this; }
+
+        constexpr bool operator<(Quantity o) const { return value < o.value; }
+        constexpr bool operator>(Quantity o) const { return value > o.value; }
+        constexpr bool operator<=(Quantity o) const { return value <= o.value; }
+        constexpr bool operator>=(Quantity o) const { return value >= o.value; }
+        constexpr bool operator==(Quantity o) const { return value == o.value; }
+        constexpr bool operator!=(Quantity o) const { return value != o.value; }
+    };
+
+    template <class Tag>
+    constexpr Quantity<Tag> operator*(double k, Quantity<Tag> q) { return q * k; }
+
+    template <class Tag>
+    std::ostream& operator<<(std::ostream& os, Quantity<Tag> q) { return os << q.value; }
+
+    struct BtuHrTag {};
+    struct KwTag {};
+    struct TonTag {};
+    struct CfmTag {};
+    struct GpmTag {};
+    struct DeltaFTag {};
+    struct SqFtTag {};
+    struct CuFtTag {};
+    struct UValueTag {};
+    struct RValueTag {};
+    struct AchTag {};
+    struct AirFactorTag {};
+    struct FluidFactorTag {};
+    struct IrradianceTag {};
+    struct HumRatioTag {};
+
+    using BtuHr = Quantity<BtuHrTag>;   // BTU/hr
+    using Kw = Quantity<KwTag>;         // kW
+    using Tons = Quantity<TonTag>;      // refrigeration tons
+    using Cfm = Quantity<CfmTag>;       // ft^3/min
+    using Gpm = Quantity<GpmTag>;       // US gal/min
+    using DeltaF = Quantity<DeltaFTag>; // temperature difference, F
+    using SqFt = Quantity<SqFtTag>;     // ft^2
+    using CuFt = Quantity<CuFtTag>;     // ft^3
+    using UValue = Quantity<UValueTag>; // BTU/hr·ft^2·F
+    using RValue = Quantity<RValueTag>; // hr·ft^2·F/BTU
+    using Ach = Quantity<AchTag>;       // air changes per hour
+    using AirFactor = Quantity<AirFactorTag>;     // BTU/hr per CFM·F (1.08 for standard air)
+    using FluidFactor = Quantity<FluidFactorTag>; // BTU/hr per GPM·F (500 for water)
+    using Irradiance = Quantity<IrradianceTag>;   // solar, BTU/hr·ft^2
+    using HumRatio = Quantity<HumRatioTag>;       // lb water / lb dry air (same as kg/kg)
+
+    // Absolute temperature (F). Kept apart from DeltaF: two temperatures
+    // subtract to a difference, but never add.
+    struct DegF {
+        double value = 0.0;
+
+        constexpr DegF() = default;
+        constexpr explicit DegF(double v) : value(v) {}
+
+        constexpr DeltaF operator-(DegF o) const { return DeltaF(value - o.value); }
+        constexpr DegF operator+(DeltaF d) const { return DegF(value + d.value); }
+        constexpr DegF operator-(DeltaF d) const { return DegF(value - d.value); }
+    };
+
+    inline std::ostream& operator<<(std::ostream& os, DegF t) { return os << t.value; }
+
+    static_assert(sizeof(BtuHr) == sizeof(double) && alignof(BtuHr) == alignof(double),
+        "Quantity must stay layout-compatible with double");
+    static_assert(std::is_trivially_copyable<BtuHr>::value,
+        "Quantity must stay trivially copyable");
+
+    constexpr Kw btuhr_to_kw(BtuHr btuhr) { return Kw(btuhr.value / BTU_PER_HR_PER_KW); }
+    constexpr BtuHr kw_to_btuhr(Kw kw) { return BtuHr(kw.value * BTU_PER_HR_PER_KW); }
+    constexpr Tons btuhr_to_ton(BtuHr btuhr) { return Tons(btuhr.value / BTU_PER_HR_PER_TON); }
+    constexpr BtuHr ton_to_btuhr(Tons ton) { return BtuHr(ton.value * BTU_PER_HR_PER_TON); }
+    constexpr UValue u_from_r(RValue r) { return UValue(1.0 / r.value); }
+
+    // ------------------------ SI ------------------------
+
+    enum class System { Imperial, SI };
+
+    inline const char* systemName(System s) { return s == System::SI ? "SI" : "Imperial"; }
+
+    constexpr double BTU_PER_HR_PER_W = BTU_PER_HR_PER_KW / 1000.0;
+    constexpr double CFM_PER_LPS = 2.11888;    // 1 L/s  = 2.11888 CFM
+    constexpr double GPM_PER_M3H = 4.402868;   // 1 m³/h = 4.402868 US GPM
+    constexpr double FT_PER_M = 1.0 / 0.3048;  // 1 m    = 3.2808 ft
+    constexpr double FT2_PER_M2 = 10.7639104;  // 1 m²   = 10.7639 ft²
+    constexpr double FT3_PER_M3 = 35.3146667;  // 1 m³   = 35.3147 ft³
+    constexpr double F_PER_K = 1.8;            // 1 K difference = 1.8 F difference
+    constexpr double U_PER_U_SI = BTU_PER_HR_PER_W / (FT2_PER_M2 * F_PER_K); // W/m²·K -> BTU/hr·ft²·F
+
+    struct WattTag {};
+    struct LpsTag {};
+    struct M3hTag {};
+    struct SqMTag {};
+    struct CuMTag {};
+    struct DeltaKTag {};
+    struct UValueSITag {};
+    struct RValueSITag {};
+    struct IrradianceSITag {};
+
+    using Watts = Quantity<WattTag>;        // W
+    using Lps = Quantity<LpsTag>;           // L/s
+    using M3h = Quantity<M3hTag>;           // m³/h
+    using SqM = Quantity<SqMTag>;           // m²
+    using CuM = Quantity<CuMTag>;           // m³
+    using DeltaK = Quantity<DeltaKTag>;     // temperature difference, K
+    using UValueSI = Quantity<UValueSITag>; // W/m²·K
+    using RValueSI = Quantity<RValueSITag>; // m²·K/W
+    using IrradianceSI = Quantity<IrradianceSITag>; // W/m²
+
+    constexpr BtuHr w_to_btuhr(Watts w) { return BtuHr(w.value * BTU_PER_HR_PER_W); }
+    constexpr Watts btuhr_to_w(BtuHr btuhr) { return Watts(btuhr.value / BTU_PER_HR_PER_W); }
+    constexpr Kw w_to_kw(Watts w) { return Kw(w.value / 1000.0); }
+    constexpr Cfm lps_to_cfm(Lps q) { return Cfm(q.value * CFM_PER_LPS); }
+    constexpr Gpm m3h_to_gpm(M3h q) { return Gpm(q.value * GPM_PER_M3H); }
+    constexpr SqFt sqm_to_sqft(SqM a) { return SqFt(a.value * FT2_PER_M2); }
+    constexpr CuFt cum_to_cuft(CuM v) { return CuFt(v.value * FT3_PER_M3); }
+    constexpr DeltaF deltak_to_deltaf(DeltaK d) { return DeltaF(d.value * F_PER_K); }
+    constexpr UValue usi_to_u(UValueSI u) { return UValue(u.value * U_PER_U_SI); }
+    constexpr UValueSI usi_from_rsi(RValueSI r) { return UValueSI(1.0 / r.value); }
+    constexpr Irradiance irrsi_to_irr(IrradianceSI i) { return Irradiance(i.value * BTU_PER_HR_PER_W / FT2_PER_M2); }
+
+    // Whole-column conversions for imported data. Plain counted loops over
+    // contiguous doubles so the compiler vectorizes them.
+    void scale_column(double* col, std::size_t n, double k) {
+        for (std::size_t i = 0; i < n; ++i) col[i] *= k;
+    }
+
+    // Per-row factor picked from a small table by a row key (e.g. method code).
+    void scale_column_by_key(double* col, const std::uint8_t* key, const double* table, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) col[i] *= table[key[i]];
+    }
 
 } // namespace units
 
-struct LoadItem {
-    std::string name;
-    std::string method;
-    double btu_per_hr = 0.0;
-};
+namespace numeric {
+
+    // Running sum with a compensation term (Neumaier's variant of Kahan). The
+    // branch-free TwoSum form keeps the rounding error of every addition, so
+    // the result is accurate to about one ulp of the total regardless of how
+    // many mixed-sign terms went in.
+    struct CompensatedSum {
+        double sum = 0.0;
+        double comp = 0.0;
+
+        void add(double x) {
+            double t = sum + x;
+            double z = t - sum;
+            comp += (sum - (t - z)) + (x - z);
+            sum = t;
+        }
+
+        void merge(const CompensatedSum& o) {
+            add(o.sum);
+            comp += o.comp;
+        }
+
+        double result() const { return sum + comp; }
+    };
+
+    // Element i goes to lane i % LANES; lanes are independent so the inner loop
+    // has no carried dependency beyond its own lane and can be packed into
+    // SIMD registers. Blocks have a fixed size and their partials are combined
+    // in a fixed pairwise tree, so the result depends only on the data and its
+    // order, never on thread count or scheduling.
+    constexpr std::size_t LANES = 4;
+    constexpr std::size_t BLOCK = std::size_t(1) << 14;
+    constexpr std::size_t PARALLEL_MIN = std::size_t(1) << 20;
+
+    template <class At>
+    CompensatedSum sumBlock(At at, std::size_t begin, std::size_t end) {
+        double s[LANES] = {}, c[LANES] = {};
+        std::size_t i = begin;
+        for (; i + LANES <= end; i += LANES) {
+            for (std::size_t l = 0; l < LANES; ++l) {
+                double x = at(i + l);
+                double t = s[l] + x;
+                double z = t - s[l];
+                c[l] += (s[l] - (t - z)) + (x - z);
+                s[l] = t;
+            }
+        }
+
+        CompensatedSum lanes[LANES];
+        for (std::size_t l = 0; l < LANES; ++l) {
+            lanes[l].sum = s[l];
+            lanes[l].comp = c[l];
+        }
+        for (std::size_t l = 0; i < end; ++i, ++l) lanes[l].add(at(i));
+
+        lanes[0].merge(lanes[1]);
+        lanes[2].merge(lanes[3]);
+        lanes[0].merge(lanes[2]);
+        return lanes[0];
+    }
+
+    inline CompensatedSum combineTree(std::vector<CompensatedSum>& parts) {
+        if (parts.empty()) return CompensatedSum();
+        for (std::size_t stride = 1; stride < parts.size(); stride *= 2)
+            for (std::size_t i = 0; i + stride < parts.size(); i += 2 * stride)
+                parts[i].merge(parts[i + stride]);
+        return parts[0];
+    }
+
+    // Runs task(0) .. task(tasks-1), spreading contiguous task ranges over the
+    // hardware threads when `parallel` is set. Tasks must write disjoint output.
+    template <class Task>
+    void parallelFor(std::size_t tasks, bool parallel, Task task) {
+        unsigned hw = std::thread::hardware_concurrency();
+        std::size_t workers = (parallel && hw > 1) ? std::min<std::size_t>(hw, tasks) : 1;
+        auto run = [&task](std::size_t t0, std::size_t t1) {
+            for (std::size_t t = t0; t < t1; ++t) task(t);
+        };
+        if (workers <= 1) {
+            run(0, tasks);
+            return;
+        }
+
+        std::vector<std::thread> pool;
+        std::size_t per = (tasks + workers - 1) / workers;
+        for (std::size_t w = 1; w < workers; ++w) {
+            std::size_t t0 = std::min(tasks, w * per), t1 = std::min(tasks, (w + 1) * per);
+            if (t0 < t1) pool.emplace_back(run, t0, t1);
+        }
+        run(0, std::min(tasks, per));
+        for (std::thread& t : pool) t.join();
+    }
+
+    // Work-stealing task pool. Each worker has its own deque: spawned tasks go
+    // on its back and it takes from the back (newest first, data still warm),
+    // while an idle worker steals from the front of another's deque (oldest,
+    // usually the biggest piece left). Tasks may spawn more tasks; run()
+    // returns once every task, spawned ones included, has finished. Tasks must
+    // not throw.
+    class TaskPool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit TaskPool(std::size_t workers) : queues(std::max<std::size_t>(workers, 1)) {}
+
+        std::size_t workers() const { return queues.size(); }
+
+        // Queues a task on the calling worker's deque; from outside run(), on
+        // worker 0's.
+        void spawn(Task t) {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            Queue& q = queues[self < queues.size() ? self : 0];
+            std::lock_guard<std::mutex> lock(q.m);
+            q.tasks.push_back(std::move(t));
+        }
+
+        void run() {
+            std::vector<std::thread> pool;
+            for (std::size_t w = 1; w < queues.size(); ++w) pool.emplace_back([this, w] { work(w); });
+            work(0);
+            for (std::thread& t : pool) t.join();
+            self = 0;
+        }
+
+    private:
+        struct Queue {
+            std::mutex m;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<Queue> queues;
+        // Queued plus running; a task's children are counted before it is
+        // retired, so this only reaches zero when all work is done.
+        std::atomic<std::size_t> pending{ 0 };
+        static inline thread_local std::size_t self = 0;
+
+        bool take(std::size_t w, Task& t) {
+            {
+                Queue& own = queues[w];
+                std::lock_guard<std::mutex> lock(own.m);
+                if (!own.tasks.empty()) {
+                    t = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (std::size_t k = 1; k < queues.size(); ++k) {
+                Queue& victim = queues[(w + k) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.m);
+                if (!victim.tasks.empty()) {
+                    t = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void work(std::size_t w) {
+            self = w;
+            Task t;
+            while (pending.load(std::memory_order_acquire) > 0) {
+                if (take(w, t)) {
+                    t();
+                    t = nullptr;
+                    pending.fetch_sub(1, std::memory_order_acq_rel);
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    };
+
+    // Deterministic compensated sum of at(0) .. at(n-1). Large inputs are split
+    // across hardware threads by whole blocks unless `parallel` is off, e.g.
+    // when the caller is already one of several workers; the result is the same.
+    template <class At>
+    double sumIndexed(std::size_t n, At at, bool parallel = true) {
+        const std::size_t blocks = (n + BLOCK - 1) / BLOCK;
+        std::vector<CompensatedSum> parts(blocks);
+        parallelFor(blocks, parallel && n >= PARALLEL_MIN, [&](std::size_t b) {
+            parts[b] = sumBlock(at, b * BLOCK, std::min(n, (b + 1) * BLOCK));
+        });
+        return combineTree(parts).result();
+    }
+
+    double sum(const double* x, std::size_t n) {
+        return sumIndexed(n, [x](std::size_t i) { return x[i]; });
+    }
+
+} // namespace numeric
+
 
 namespace calcs {
 
+    constexpr units::AirFactor STANDARD_AIR(1.08);
+    constexpr units::FluidFactor STANDARD_WATER(500.0);
+
     // Qs (BTU/hr) = 1.08 * CFM * ΔT(F)
-    double air_sensible_btuhr(double cfm, double deltaT_F) {
-        return 1.08 * cfm * deltaT_F;
+    constexpr units::BtuHr air_sensible_btuhr(units::Cfm cfm, units::DeltaF deltaT) {
+        return units::BtuHr(STANDARD_AIR.value * cfm.value * deltaT.value);
+    }
+
+    // Qs (BTU/hr) = k * CFM * ΔT(F), k from props::air_sensible_factor
+    constexpr units::BtuHr air_sensible_btuhr(units::Cfm cfm, units::DeltaF deltaT, units::AirFactor k) {
+        return units::BtuHr(k.value * cfm.value * deltaT.value);
     }
 
     // Q (BTU/hr) = 500 * GPM * ΔT(F)
-    double hydronic_btuhr(double gpm, double deltaT_F) {
-        return 500.0 * gpm * deltaT_F;
+    constexpr units::BtuHr hydronic_btuhr(units::Gpm gpm, units::DeltaF deltaT) {
+        return units::BtuHr(STANDARD_WATER.value * gpm.value * deltaT.value);
+    }
+
+    // Q (BTU/hr) = k * GPM * ΔT(F), k from props::hydronic_factor
+    constexpr units::BtuHr hydronic_btuhr(units::Gpm gpm, units::DeltaF deltaT, units::FluidFactor k) {
+        return units::BtuHr(k.value * gpm.value * deltaT.value);
     }
 
     // Q (BTU/hr) = U * A * ΔT(F)
-    double conduction_btuhr(double U, double area_ft2, double deltaT_F) {
-        return U * area_ft2 * deltaT_F;
+    constexpr units::BtuHr conduction_btuhr(units::UValue U, units::SqFt area, units::DeltaF deltaT) {
+        return units::BtuHr(U.value * area.value * deltaT.value);
     }
 
     // CFM = ACH * Volume(ft³) / 60
-    double cfm_from_ach(double ach, double volume_ft3) {
-        return (ach * volume_ft3) / 60.0;
+    constexpr units::Cfm cfm_from_ach(units::Ach ach, units::CuFt volume) {
+        return units::Cfm((ach.value * volume.value) / 60.0);
+    }
+
+    // SI forms. The constants are the imperial 1.08 and 500 carried through the
+    // unit factors above, so an SI input and its imperial equivalent give the
+    // same load (1.2 W/(L/s·K) for air, ~1161 W/(m³/h·K) for water).
+    constexpr double air_w_per_lps_k(units::AirFactor k) {
+        return k.value * units::CFM_PER_LPS * units::F_PER_K / units::BTU_PER_HR_PER_W;
+    }
+
+    constexpr double water_w_per_m3h_k(units::FluidFactor k) {
+        return k.value * units::GPM_PER_M3H * units::F_PER_K / units::BTU_PER_HR_PER_W;
+    }
+
+    constexpr double AIR_W_PER_LPS_K = air_w_per_lps_k(STANDARD_AIR);
+    constexpr double WATER_W_PER_M3H_K = water_w_per_m3h_k(STANDARD_WATER);
+
+    // Qs (W) = 1.2 * L/s * ΔT(K)
+    constexpr units::Watts air_sensible_w(units::Lps lps, units::DeltaK deltaT, units::AirFactor k = STANDARD_AIR) {
+        return units::Watts(air_w_per_lps_k(k) * lps.value * deltaT.value);
+    }
+
+    // Q (W) = 1161 * m³/h * ΔT(K)
+    constexpr units::Watts hydronic_w(units::M3h m3h, units::DeltaK deltaT, units::FluidFactor k = STANDARD_WATER) {
+        return units::Watts(water_w_per_m3h_k(k) * m3h.value * deltaT.value);
+    }
+
+    // Q (W) = U * A * ΔT(K)
+    constexpr units::Watts conduction_w(units::UValueSI U, units::SqM area, units::DeltaK deltaT) {
+        return units::Watts(U.value * area.value * deltaT.value);
+    }
+
+    // L/s = ACH * Volume(m³) * 1000 / 3600
+    constexpr units::Lps lps_from_ach(units::Ach ach, units::CuM volume) {
+        return units::Lps(ach.value * volume.value / 3.6);
+    }
+
+    // ------------------------ COOLING ------------------------
+
+    // Latent air constant: 60 min/hr * 0.075 lb/ft³ * 1076 BTU/lb. It scales
+    // with air density exactly as 1.08 does, so a corrected sensible factor
+    // carries over as k / 1.08.
+    constexpr double STANDARD_LATENT = 4840.0;
+
+    constexpr double latent_factor(units::AirFactor k) {
+        return STANDARD_LATENT * k.value / STANDARD_AIR.value;
+    }
+
+    constexpr double BTUHR_PER_PERSON = 250.0; // seated, light office work (sensible)
+
+    // Q (BTU/hr) = SHGC * A * I
+    constexpr units::BtuHr solar_btuhr(double shgc, units::SqFt area, units::Irradiance irr) {
+        return units::BtuHr(shgc * area.value * irr.value);
+    }
+
+    // Q (BTU/hr) = count * gain per unit * diversity. Count is people or
+    // watts; per-unit gain is 250 BTU/hr a person or 3.412 BTU/hr a watt.
+    constexpr units::BtuHr internal_btuhr(double count, units::BtuHr perUnit, double diversity = 1.0) {
+        return units::BtuHr(count * perUnit.value * diversity);
+    }
+
+    // Ql (BTU/hr) = 4840 * CFM * ΔW(lb/lb)
+    constexpr units::BtuHr latent_btuhr(units::Cfm cfm, units::HumRatio dW, units::AirFactor k = STANDARD_AIR) {
+        return units::BtuHr(latent_factor(k) * cfm.value * dW.value);
+    }
+
+    // SI: ~3006 W per L/s per kg/kg, again carried through the unit factors.
+    constexpr double latent_w_per_lps(units::AirFactor k) {
+        return latent_factor(k) * units::CFM_PER_LPS / units::BTU_PER_HR_PER_W;
+    }
+
+    // Q (W) = SHGC * A(m²) * I(W/m²)
+    constexpr units::Watts solar_w(double shgc, units::SqM area, units::IrradianceSI irr) {
+        return units::Watts(shgc * area.value * irr.value);
+    }
+
+    // Ql (W) = 3006 * L/s * ΔW(kg/kg)
+    constexpr units::Watts latent_w(units::Lps lps, units::HumRatio dW, units::AirFactor k = STANDARD_AIR) {
+        return units::Watts(latent_w_per_lps(k) * lps.value * dW.value);
+    }
+
+    // ------------------------ BATCH ------------------------
+
+    enum class Method : std::uint8_t { AirSens, Hydronic, Conduction, AchAir, Solar, Internal, Latent };
+    constexpr int METHOD_COUNT = 7;
+
+    inline const char* methodLabel(Method m) {
+        static const char* const labels[METHOD_COUNT] = {
+            "AirSens", "Hydronic", "Cond(UA)", "ACH->Air", "Solar", "Internal", "Latent" };
+        return labels[static_cast<int>(m)];
+    }
+
+    bool parseMethod(const std::string& s, Method& out) {
+        for (int i = 0; i < METHOD_COUNT; ++i) {
+            if (s == methodLabel(static_cast<Method>(i))) {
+                out = static_cast<Method>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // False for the two-input methods, whose batch form takes c = 1.
+    constexpr bool hasThirdInput(Method m) {
+        return m != Method::AirSens && m != Method::Hydronic && m != Method::Latent;
+    }
+
+    // Every method above is a constant times up to three inputs, so a batch is
+    // evaluated branch-free as out = K[method] * a * b * c. Column layout
+    // (imperial), with c = 1 for the two-input methods:
+    //   AirSens   a = CFM   b = dT(F)   c = 1
+    //   Hydronic  a = GPM   b = dT(F)   c = 1
+    //   Cond(UA)  a = U     b = ft^2    c = dT(F)
+    //   ACH->Air  a = ACH   b = ft^3    c = dT(F)
+    //   Solar     a = SHGC  b = ft^2    c = BTU/hr·ft^2
+    //   Internal  a = count b = BTU/hr each  c = diversity
+    //   Latent    a = CFM   b = dW(lb/lb)  c = 1
+    struct BatchFactors {
+        double k[METHOD_COUNT];
+    };
+
+    constexpr BatchFactors batchFactors(units::AirFactor air, units::FluidFactor fluid) {
+        return BatchFactors{ { air.value, fluid.value, 1.0, air.value / 60.0, 1.0, 1.0, latent_factor(air) } };
+    }
+
+    constexpr BatchFactors STANDARD_BATCH = batchFactors(STANDARD_AIR, STANDARD_WATER);
+
+    // Where a method's ΔT comes from. Air, conduction and ACH loads follow the
+    // indoor-outdoor difference, hydronic loads their own supply-return
+    // difference; the cooling gains have no ΔT input.
+    enum class DtSource : std::uint8_t { None, Outdoor, Water };
+    constexpr int DT_SOURCE_COUNT = 3;
+
+    inline DtSource dtSource(Method m) {
+        static const DtSource sources[METHOD_COUNT] = { DtSource::Outdoor, DtSource::Water, DtSource::Outdoor,
+            DtSource::Outdoor, DtSource::None, DtSource::None, DtSource::None };
+        return sources[static_cast<int>(m)];
+    }
+
+    // Batch column holding ΔT: 1 for b, 2 for c, 0 for none.
+    inline int dtColumn(Method m) {
+        static const std::uint8_t columns[METHOD_COUNT] = { 1, 1, 2, 2, 0, 0, 0 };
+        return columns[static_cast<int>(m)];
+    }
+
+    void evaluate_batch(const Method* m, const double* a, const double* b, const double* c,
+        double* out, std::size_t n, const BatchFactors& f = STANDARD_BATCH) {
+        const std::uint8_t* key = reinterpret_cast<const std::uint8_t*>(m);
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = f.k[key[i]] * a[i] * b[i] * c[i];
+    }
+
+    // One method over whole arrays; c may be null for c = 1.
+    void evaluate_batch(Method m, const double* a, const double* b, const double* c,
+        double* out, std::size_t n, const BatchFactors& f = STANDARD_BATCH) {
+        const double k = f.k[static_cast<int>(m)];
+        if (c) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = k * a[i] * b[i] * c[i];
+        }
+        else {
+            for (std::size_t i = 0; i < n; ++i) out[i] = k * a[i] * b[i];
+        }
+    }
+
+    // Q = U * A * ΔT over whole arrays, e.g. every surface of an envelope.
+    void conduction_btuhr(const units::UValue* U, const units::SqFt* area, const units::DeltaF* deltaT,
+        units::BtuHr* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = units::BtuHr(U[i].value * area[i].value * deltaT[i].value);
     }
 
+    static_assert(air_sensible_btuhr(units::Cfm(1000.0), units::DeltaF(20.0)).value == 1.08 * 1000.0 * 20.0,
+        "air_sensible_btuhr must fold at compile time");
+
 } // namespace calcs
 
-namespace ui {
+struct LoadItem {
+    std::string name;
+    calcs::Method method = calcs::Method::AirSens;
+    units::BtuHr btu_per_hr;
+    std::string zone;
+    std::string tag;
 
-    void printHeader() {
-        std::cout << "=============================================\n";
-        std::cout << " HEAT LOAD CALCULATOR (Console) - Imperial\n";
-        std::cout << " Methods: Air Sensible | Hydronic | Conduction | ACH\n";
-        std::cout << "---------------------------------------------\n";
-        std::cout << " Notes:\n";
-        std::cout << "  - Quick-calcs intended for preliminary sizing.\n";
-        std::cout << "  - Verify assumptions, code requirements, and design standards.\n";
-        std::cout << "=============================================\n\n";
+    // Inputs in calcs::evaluate_batch layout (imperial), kept so the item can
+    // be re-evaluated when an assembly or condition changes.
+    double a = 0.0;
+    double b = 0.0;
+    double c = 1.0;
+    std::uint32_t assembly = 0; // envelope::Library id for Cond(UA), 0 = U entered directly
+
+    // Move-only: builders hand their result on without copying the strings,
+    // and the store interns from it rather than keeping it.
+    LoadItem() = default;
+    LoadItem(LoadItem&&) = default;
+    LoadItem& operator=(LoadItem&&) = default;
+    LoadItem(const LoadItem&) = delete;
+    LoadItem& operator=(const LoadItem&) = delete;
+};
+
+// Bump allocator for strings that live as long as their owner: they are
+// copied in back to back and freed all at once with it, instead of one heap
+// block each. Wraps a std::pmr::monotonic_buffer_resource, which can also
+// back pmr containers through resource(). The resource is held by pointer,
+// so the owner stays movable and views into it survive the move.
+class Arena {
+public:
+    Arena() : res(std::make_unique<std::pmr::monotonic_buffer_resource>(4096)) {}
+
+    std::string_view store(std::string_view s) {
+        if (s.empty()) return std::string_view();
+        char* p = static_cast<char*>(res->allocate(s.size(), 1));
+        std::memcpy(p, s.data(), s.size());
+        return std::string_view(p, s.size());
     }
 
-    void printItemTable(const std::vector<LoadItem>& items) {
-        std::cout << "\n------------------ PROJECT LOAD SUMMARY ------------------\n";
-        std::cout << std::left
-            << std::setw(4) << "#"
-            << std::setw(28) << "Name"
-            << std::setw(14) << "Method"
-            << std::right
-            << std::setw(14) << "BTU/hr"
-            << std::setw(12) << "kW"
-            << std::setw(10) << "Tons"
-            << "\n";
+    std::pmr::memory_resource* resource() { return res.get(); }
 
-        std::cout << std::string(82, '-') << "\n";
+private:
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> res;
+};
 
-        double total = 0.0;
-        for (size_t i = 0; i < items.size(); ++i) {
-            total += items[i].btu_per_hr;
-            std::cout << std::left
-                << std::setw(4) << (std::to_string(i + 1) + ")")
-                << std::setw(28) << items[i].name.substr(0, 27)
-                << std::setw(14) << items[i].method.substr(0, 13)
-                << std::right
-                << std::setw(14) << std::fixed << std::setprecision(1) << items[i].btu_per_hr
-                << std::setw(12) << std::fixed << std::setprecision(3) << units::btuhr_to_kw(items[i].btu_per_hr)
-                << std::setw(10) << std::fixed << std::setprecision(3) << units::btuhr_to_ton(items[i].btu_per_hr)
-                << "\n";
+// Interned strings: each distinct value is stored once and rows refer to it
+// by a dense id, which then serves as a perfect hash for group-by. Values sit
+// in an arena and are found through an open-addressing table of ids, so
+// interning a new string costs no allocation of its own.
+struct Dictionary {
+    static constexpr std::uint32_t EMPTY = ~std::uint32_t(0);
+
+    Arena text;
+    std::vector<std::string_view> values;
+    std::vector<std::uint32_t> slots; // ids, kept at most half full
+
+    std::uint32_t intern(std::string_view s) {
+        if (slots.size() < 2 * (values.size() + 1)) rehash(std::max<std::size_t>(16, slots.size() * 2));
+        const std::size_t mask = slots.size() - 1;
+        for (std::size_t h = std::hash<std::string_view>()(s) & mask;; h = (h + 1) & mask) {
+            if (slots[h] == EMPTY) {
+                std::uint32_t id = static_cast<std::uint32_t>(values.size());
+                values.push_back(text.store(s));
+                slots[h] = id;
+                return id;
+            }
+            if (values[slots[h]] == s) return slots[h];
         }
+    }
 
-        std::cout << std::string(82, '-') << "\n";
-        std::cout << std::right
-            << std::setw(46) << "TOTAL:"
-            << std::setw(14) << std::fixed << std::setprecision(1) << total
-            << std::setw(12) << std::fixed << std::setprecision(3) << units::btuhr_to_kw(total)
-            << std::setw(10) << std::fixed << std::setprecision(3) << units::btuhr_to_ton(total)
-            << "\n";
-        std::cout << "----------------------------------------------------------\n\n";
+    void rehash(std::size_t n) {
+        slots.assign(n, EMPTY);
+        for (std::uint32_t id = 0; id < values.size(); ++id) {
+            std::size_t h = std::hash<std::string_view>()(values[id]) & (n - 1);
+            while (slots[h] != EMPTY) h = (h + 1) & (n - 1);
+            slots[h] = id;
+        }
     }
 
-    void exportCSV(const std::vector<LoadItem>& items, const std::string& path) {
-        std::ofstream out(path);
-        if (!out) {
-            std::cout << "  ***Error*** Could not write file: " << path << "\n";
-            return;
+    std::string_view operator[](std::uint32_t id) const { return values[id]; }
+    std::size_t size() const { return values.size(); }
+};
+
+namespace envelope {
+
+    // One material layer. `r` is its resistance along the insulated (cavity)
+    // path and `rFraming` along the studs/joists; the two are equal for
+    // continuous layers such as sheathing or board insulation.
+    struct Layer {
+        std::string name;
+        units::RValue r;
+        units::RValue rFraming;
+    };
+
+    struct Assembly {
+        std::string name;
+        double framingFraction = 0.0;
+        units::RValue insideFilm = units::RValue(0.68);  // still air, vertical surface
+        units::RValue outsideFilm = units::RValue(0.17); // 15 mph wind
+        std::vector<Layer> layers;
+    };
+
+    // Parallel-path method: films and layers add in series along each path,
+    // and the paths combine by area, U = f / R_framing + (1 - f) / R_cavity.
+    units::UValue effectiveU(const Assembly& a) {
+        double rCavity = a.insideFilm.value + a.outsideFilm.value;
+        double rFraming = rCavity;
+        for (const Layer& l : a.layers) {
+            rCavity += l.r.value;
+            rFraming += l.rFraming.value;
         }
+        return units::UValue(a.framingFraction / rFraming + (1.0 - a.framingFraction) / rCavity);
+    }
 
-        out << "Index,Name,Method,BTU_per_hr,kW,Tons\n";
-        double total = 0.0;
+    // Constructions referenced from Cond(UA) items by id (0 = U entered
+    // directly). Each U-value is worked out once, when the assembly is
+    // defined, into a flat table, so evaluating surfaces is a gather.
+    struct Library {
+        std::vector<Assembly> assemblies = std::vector<Assembly>(1); // slot 0 unused
+        std::vector<units::UValue> u = std::vector<units::UValue>(1);
+        std::unordered_map<std::string, std::uint32_t> ids;
 
-        for (size_t i = 0; i < items.size(); ++i) {
-            total += items[i].btu_per_hr;
-            out << (i + 1) << ","
-                << "\"" << items[i].name << "\","
-                << "\"" << items[i].method << "\","
-                << std::fixed << std::setprecision(1) << items[i].btu_per_hr << ","
-                << std::fixed << std::setprecision(3) << units::btuhr_to_kw(items[i].btu_per_hr) << ","
-                << std::fixed << std::setprecision(3) << units::btuhr_to_ton(items[i].btu_per_hr)
-                << "\n";
+        std::size_t size() const { return assemblies.size() - 1; }
+
+        // Adds the assembly, or replaces the one with the same name. Returns its id.
+        std::uint32_t define(Assembly a) {
+            units::UValue ua = effectiveU(a);
+            auto it = ids.find(a.name);
+            if (it != ids.end()) {
+                assemblies[it->second] = std::move(a);
+                u[it->second] = ua;
+                return it->second;
+            }
+            std::uint32_t id = static_cast<std::uint32_t>(assemblies.size());
+            ids.emplace(a.name, id);
+            assemblies.push_back(std::move(a));
+            u.push_back(ua);
+            return id;
         }
 
-        out << ",\"TOTAL\",\"\","
-            << std::fixed << std::setprecision(1) << total << ","
-            << std::fixed << std::setprecision(3) << units::btuhr_to_kw(total) << ","
-            << std::fixed << std::setprecision(3) << units::btuhr_to_ton(total) << "\n";
+        bool find(const std::string& name, std::uint32_t& id) const {
+            auto it = ids.find(name);
+            if (it == ids.end()) return false;
+            id = it->second;
+            return true;
+        }
+    };
 
-        std::cout << "  Saved: " << path << "\n";
+    // Replaces U with the library value for rows that reference an assembly.
+    void gatherU(const Library& lib, const std::uint32_t* ids, double* u, std::size_t n) {
+        const units::UValue* table = lib.u.data();
+        for (std::size_t i = 0; i < n; ++i)
+            u[i] = ids[i] ? table[ids[i]].value : u[i];
     }
 
-} // namespace ui
+    void gatherU(const Library& lib, const std::uint32_t* ids, units::UValue* u, std::size_t n) {
+        const units::UValue* table = lib.u.data();
+        for (std::size_t i = 0; i < n; ++i)
+            u[i] = ids[i] ? table[ids[i]] : u[i];
+    }
+
+} // namespace envelope
+
+// Formulas for derived inputs, e.g. "=area*height" for an ACH volume or
+// "=occupants*cfm_pp" for outdoor air. They refer to named variables, set by
+// "# let" lines in a project file or from the Variables menu.
+//
+// A formula is compiled once into register bytecode: constants are folded
+// while parsing, each operator becomes one instruction on fixed registers,
+// and the result is left in register 0. Items that share a formula share its
+// program, which runs once per evaluation; the items then gather its value,
+// like assembly U-values. So a million rows over a few formulas cost about
+// the same as a million typed numbers.
+namespace expr {
+
+    enum class Op : std::uint8_t { Const, Var, Add, Sub, Mul, Div, Neg, Min, Max };
+
+    struct Instr {
+        Op op;
+        std::uint8_t dst, x, y;
+        std::uint32_t arg; // constant index for Const, variable id for Var
+    };
+
+    constexpr int REGISTERS = 16; // nesting deeper than this is rejected
+
+    struct Program {
+        std::vector<Instr> code;
+        std::vector<double> constants;
+    };
+
+    // Variable names and current values; a name referenced before it is
+    // defined reads as 0.
+    struct Variables {
+        Dictionary names;
+        std::vector<double> values;
+        std::vector<std::uint8_t> defined;
+
+        std::size_t size() const { return values.size(); }
+
+        std::uint32_t id(std::string_view name) {
+            std::uint32_t k = names.intern(name);
+            if (k == values.size()) {
+                values.push_back(0.0);
+                defined.push_back(0);
+            }
+            return k;
+        }
+
+        void set(std::uint32_t k, double v) {
+            values[k] = v;
+            defined[k] = 1;
+        }
+    };
+
+    inline bool nameStart(char ch) { return std::isalpha(static_cast<unsigned char>(ch)) || ch == '_'; }
+    inline bool nameChar(char ch) { return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_'; }
+
+    // Recursive descent over
+    //   sum     = product { ("+" | "-") product }
+    //   product = unary { ("*" | "/") unary }
+    //   unary   = "-" unary | atom
+    //   atom    = number | name | ("min" | "max") "(" sum "," sum ")" | "(" sum ")"
+    // Each rule leaves its value in register `r` and may use the registers
+    // above it, or returns a constant that has not been emitted yet.
+    class Compiler {
+    public:
+        Compiler(std::string_view text, Variables& vars, Program& out) : s(text), vars(vars), out(out) {}
+
+        bool run(double scale) {
+            out.code.clear();
+            out.constants.clear();
+            Value v = sum(0);
+            skipSpace();
+            if (!ok || pos != s.size()) return false;
+            if (scale != 1.0) v = binary(Op::Mul, v, Value{ true, scale }, 0);
+            materialize(v, 0);
+            return true;
+        }
+
+    private:
+        struct Value {
+            bool constant = false;
+            double k = 0.0;
+        };
+
+        std::string_view s;
+        Variables& vars;
+        Program& out;
+        std::size_t pos = 0;
+        bool ok = true;
+
+        void skipSpace() {
+            while (pos < s.size() && s[pos] == ' ') ++pos;
+        }
+
+        bool accept(char ch) {
+            skipSpace();
+            if (pos < s.size() && s[pos] == ch) {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+
+        void emit(Op op, int dst, int x, int y, std::uint32_t arg = 0) {
+            out.code.push_back(Instr{ op, static_cast<std::uint8_t>(dst), static_cast<std::uint8_t>(x),
+                static_cast<std::uint8_t>(y), arg });
+        }
+
+        void materialize(Value v, int r) {
+            if (!v.constant) return;
+            emit(Op::Const, r, 0, 0, static_cast<std::uint32_t>(out.constants.size()));
+            out.constants.push_back(v.k);
+        }
+
+        static double fold(Op op, double x, double y) {
+            switch (op) {
+            case Op::Add: return x + y;
+            case Op::Sub: return x - y;
+            case Op::Mul: return x * y;
+            case Op::Div: return x / y;
+            case Op::Min: return std::min(x, y);
+            default: return std::max(x, y);
+            }
+        }
+
+        Value binary(Op op, Value x, Value y, int r) {
+            if (x.constant && y.constant) return Value{ true, fold(op, x.k, y.k) };
+            materialize(x, r);
+            materialize(y, r + 1);
+            emit(op, r, r, r + 1);
+            return Value();
+        }
+
+        Value sum(int r) {
+            Value v = product(r);
+            while (ok) {
+                if (accept('+')) v = binary(Op::Add, v, product(r + 1), r);
+                else if (accept('-')) v = binary(Op::Sub, v, product(r + 1), r);
+                else break;
+            }
+            return v;
+        }
+
+        Value product(int r) {
+            Value v = unary(r);
+            while (ok) {
+                if (accept('*')) v = binary(Op::Mul, v, unary(r + 1), r);
+                else if (accept('/')) v = binary(Op::Div, v, unary(r + 1), r);
+                else break;
+            }
+            return v;
+        }
+
+        Value unary(int r) {
+            if (!accept('-')) return atom(r);
+            Value v = unary(r);
+            if (v.constant) return Value{ true, -v.k };
+            emit(Op::Neg, r, r, 0);
+            return v;
+        }
+
+        Value atom(int r) {
+            if (r + 1 >= REGISTERS) ok = false;
+            skipSpace();
+            if (!ok || pos == s.size()) {
+                ok = false;
+                return Value();
+            }
+            if (accept('(')) {
+                Value v = sum(r);
+                if (!accept(')')) ok = false;
+                return v;
+            }
+            if (nameStart(s[pos])) {
+                std::size_t start = pos;
+                while (pos < s.size() && nameChar(s[pos])) ++pos;
+                std::string_view name = s.substr(start, pos - start);
+                if ((name == "min" || name == "max") && accept('(')) {
+                    Value x = sum(r);
+                    if (!accept(',')) ok = false;
+                    Value y = sum(r + 1);
+                    if (!accept(')')) ok = false;
+                    return binary(name == "min" ? Op::Min : Op::Max, x, y, r);
+                }
+                emit(Op::Var, r, 0, 0, vars.id(name));
+                return Value();
+            }
+            double k = 0.0;
+            auto res = std::from_chars(s.data() + pos, s.data() + s.size(), k);
+            if (res.ec != std::errc()) {
+                ok = false;
+                return Value();
+            }
+            pos = static_cast<std::size_t>(res.ptr - s.data());
+            return Value{ true, k };
+        }
+    };
+
+    // Compiles `text`, multiplying the result by `scale` (folded in when the
+    // formula is constant). Names are interned into `vars`. False if the
+    // text does not parse.
+    bool compile(std::string_view text, Variables& vars, Program& out, double scale = 1.0) {
+        return Compiler(text, vars, out).run(scale);
+    }
+
+    double run(const Program& p, const double* vars) {
+        double r[REGISTERS];
+        for (const Instr& in : p.code) {
+            switch (in.op) {
+            case Op::Const: r[in.dst] = p.constants[in.arg]; break;
+            case Op::Var: r[in.dst] = vars[in.arg]; break;
+            case Op::Add: r[in.dst] = r[in.x] + r[in.y]; break;
+            case Op::Sub: r[in.dst] = r[in.x] - r[in.y]; break;
+            case Op::Mul: r[in.dst] = r[in.x] * r[in.y]; break;
+            case Op::Div: r[in.dst] = r[in.x] / r[in.y]; break;
+            case Op::Neg: r[in.dst] = -r[in.x]; break;
+            case Op::Min: r[in.dst] = std::min(r[in.x], r[in.y]); break;
+            case Op::Max: r[in.dst] = std::max(r[in.x], r[in.y]); break;
+            }
+        }
+        return p.code.empty() ? 0.0 : r[0];
+    }
+
+    // Which formula feeds each of an item's a, b and c inputs, as Table ids;
+    // 0 = the input was typed.
+    struct Inputs {
+        std::uint32_t id[3] = { 0, 0, 0 };
+
+        bool any() const { return (id[0] | id[1] | id[2]) != 0; }
+    };
+
+    // Compiled formulas, one per distinct text and column scale (the SI to
+    // imperial factor of the input it feeds). Id 0 is reserved for typed
+    // inputs. values[id] is the result of the last evaluate().
+    struct Table {
+        Dictionary keys;
+        std::vector<Program> programs = std::vector<Program>(1);
+        std::vector<double> values = std::vector<double>(1, 0.0);
+        std::string key; // scratch
+
+        std::size_t size() const { return programs.size(); }
+
+        // The formula's id, compiling it the first time it is seen; 0 if the
+        // text does not parse.
+        std::uint32_t intern(std::string_view text, double scale, Variables& vars) {
+            key.assign(text);
+            key += '\0';
+            key.append(reinterpret_cast<const char*>(&scale), sizeof scale);
+            const std::size_t known = keys.size();
+            const std::uint32_t id = keys.intern(key) + 1;
+            if (keys.size() == known) return programs[id].code.empty() ? 0 : id;
+
+            programs.emplace_back();
+            values.push_back(0.0);
+            if (!compile(text, vars, programs.back(), scale)) programs.back().code.clear();
+            return programs.back().code.empty() ? 0 : id;
+        }
+
+        void evaluate(const Variables& vars) {
+            for (std::size_t id = 1; id < programs.size(); ++id) values[id] = run(programs[id], vars.values.data());
+        }
+    };
+
+    // Names referenced but never defined, comma separated.
+    std::string undefinedNames(const Variables& vars) {
+        std::string list;
+        for (std::uint32_t k = 0; k < vars.size(); ++k) {
+            if (vars.defined[k]) continue;
+            if (!list.empty()) list += ", ";
+            list += vars.names[k];
+        }
+        return list;
+    }
+
+} // namespace expr
+
+namespace geometry {
+
+    // Many planar polygons in flat vertex arrays: polygon k owns vertices
+    // start[k] .. start[k+1]-1. Coordinates are in ft, x east, y north, z up.
+    struct PolygonSet {
+        std::vector<double> x, y, z;
+        std::vector<std::uint32_t> start = std::vector<std::uint32_t>(1, 0);
+
+        std::size_t size() const { return start.size() - 1; }
+
+        void addVertex(double vx, double vy, double vz) {
+            x.push_back(vx);
+            y.push_back(vy);
+            z.push_back(vz);
+        }
+
+        void closePolygon() { start.push_back(static_cast<std::uint32_t>(x.size())); }
+    };
+
+    // Area and outward unit normal of every polygon by Newell's method (vertices
+    // counter-clockwise seen from outside), in one pass over the vertex arrays.
+    void areasAndNormals(const PolygonSet& p, units::SqFt* area, double* nx, double* ny, double* nz) {
+        for (std::size_t k = 0; k < p.size(); ++k) {
+            const std::uint32_t b = p.start[k], e = p.start[k + 1];
+            double sx = 0.0, sy = 0.0, sz = 0.0;
+            for (std::uint32_t i = b; i < e; ++i) {
+                const std::uint32_t j = (i + 1 < e) ? i + 1 : b;
+                sx += (p.y[i] - p.y[j]) * (p.z[i] + p.z[j]);
+                sy += (p.z[i] - p.z[j]) * (p.x[i] + p.x[j]);
+                sz += (p.x[i] - p.x[j]) * (p.y[i] + p.y[j]);
+            }
+            const double len = std::sqrt(sx * sx + sy * sy + sz * sz);
+            area[k] = units::SqFt(0.5 * len);
+            const double inv = len > 0.0 ? 1.0 / len : 0.0;
+            nx[k] = sx * inv;
+            ny[k] = sy * inv;
+            nz[k] = sz * inv;
+        }
+    }
+
+    // "Roof" / "Floor" for surfaces within ~45° of horizontal, otherwise the
+    // 8-point compass direction the surface faces.
+    const char* orientationOf(double nx, double ny, double nz) {
+        if (nz > 0.7071) return "Roof";
+        if (nz < -0.7071) return "Floor";
+        static const char* const compass[8] = { "N", "NE", "E", "SE", "S", "SW", "W", "NW" };
+        const double pi = 3.14159265358979323846;
+        double az = std::atan2(nx, ny) * 180.0 / pi; // 0 = north, 90 = east
+        if (az < 0.0) az += 360.0;
+        return compass[static_cast<int>((az + 22.5) / 45.0) % 8];
+    }
+
+} // namespace geometry
+
+namespace sizing {
+
+    // Equipment catalog: each model has a capacity curve against entering
+    // (outdoor) air temperature, as points sorted by temperature. Points are
+    // kept flat, model by model, with start[m]..start[m + 1] the points of
+    // model m; ids index `models`.
+    struct Catalog {
+        Dictionary models;
+        std::vector<double> enteringF;
+        std::vector<double> capacity; // BTU/hr
+        std::vector<std::uint32_t> start;
+
+        std::size_t size() const { return models.size(); }
+
+        // Builds the flat layout from unordered (model, temperature, capacity)
+        // rows.
+        void assign(const std::vector<std::uint32_t>& model, const std::vector<double>& t, const std::vector<double>& q) {
+            std::vector<std::uint32_t> order(model.size());
+            for (std::uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](std::uint32_t x, std::uint32_t y) {
+                return model[x] != model[y] ? model[x] < model[y] : t[x] < t[y];
+            });
+            enteringF.resize(order.size());
+            capacity.resize(order.size());
+            start.assign(models.size() + 1, 0);
+            for (std::size_t k = 0; k < order.size(); ++k) {
+                enteringF[k] = t[order[k]];
+                capacity[k] = q[order[k]];
+                ++start[model[order[k]] + 1];
+            }
+            for (std::size_t m = 0; m < models.size(); ++m) start[m + 1] += start[m];
+        }
+
+        // Capacity of model m at the entering temperature, interpolated along
+        // its curve and held at the end points outside it.
+        double capacityAt(std::uint32_t m, double t) const {
+            const double* x = enteringF.data() + start[m];
+            const double* y = capacity.data() + start[m];
+            std::size_t n = start[m + 1] - start[m];
+            if (n == 0) return 0.0;
+            if (t <= x[0]) return y[0];
+            if (t >= x[n - 1]) return y[n - 1];
+            std::size_t i = static_cast<std::size_t>(std::upper_bound(x, x + n, t) - x) - 1;
+            return y[i] + (t - x[i]) / (x[i + 1] - x[i]) * (y[i + 1] - y[i]);
+        }
+    };
+
+    // Every model rated at one design condition and sorted by capacity, so
+    // the models split the load axis into intervals (cap[k-1], cap[k]] and
+    // the best fit for a load is one binary search.
+    struct RatedIndex {
+        std::vector<double> capacity;
+        std::vector<std::uint32_t> model;
+    };
+
+    RatedIndex rate(const Catalog& cat, units::DegF entering) {
+        std::vector<std::pair<double, std::uint32_t>> rated;
+        rated.reserve(cat.size());
+        for (std::uint32_t m = 0; m < cat.size(); ++m) {
+            double q = cat.capacityAt(m, entering.value);
+            if (q > 0.0) rated.emplace_back(q, m);
+        }
+        std::sort(rated.begin(), rated.end());
+
+        RatedIndex idx;
+        idx.capacity.reserve(rated.size());
+        idx.model.reserve(rated.size());
+        for (const auto& r : rated) {
+            idx.capacity.push_back(r.first);
+            idx.model.push_back(r.second);
+        }
+        return idx;
+    }
+
+    struct Pick {
+        std::uint32_t model = 0;
+        std::uint32_t units = 0; // 0 if nothing was picked
+        double capacity = 0.0;   // BTU/hr per unit
+    };
+
+    // Smallest model that covers the load. A load beyond the largest model is
+    // split over the fewest equal units that the largest one can carry.
+    Pick select(const RatedIndex& idx, units::BtuHr load) {
+        Pick p;
+        if (idx.capacity.empty() || load.value <= 0.0) return p;
+        double need = load.value;
+        p.units = 1;
+        if (need > idx.capacity.back()) {
+            p.units = static_cast<std::uint32_t>(std::ceil(need / idx.capacity.back()));
+            need /= p.units;
+        }
+        std::size_t k = static_cast<std::size_t>(
+            std::lower_bound(idx.capacity.begin(), idx.capacity.end(), need) - idx.capacity.begin());
+        if (k == idx.capacity.size()) k = idx.capacity.size() - 1; // ceil rounding at the top
+        p.model = idx.model[k];
+        p.capacity = idx.capacity[k];
+        return p;
+    }
+
+} // namespace sizing
+
+// Row ids ordered by load, largest first (ties by id). Single adds and
+// erases keep it in step with a binary-search insert or remove; bulk loads
+// mark it stale and it is rebuilt once, by the next query that needs it.
+struct LoadIndex {
+    std::vector<std::uint32_t> order;
+    bool stale = false;
+
+    static bool before(const std::vector<units::BtuHr>& q, std::uint32_t a, std::uint32_t b) {
+        return q[a] > q[b] || (q[a] == q[b] && a < b);
+    }
+
+    void rebuild(const std::vector<units::BtuHr>& q) {
+        order.resize(q.size());
+        for (std::uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(),
+            [&q](std::uint32_t a, std::uint32_t b) { return before(q, a, b); });
+        stale = false;
+    }
+
+    // Row `id` must already be in `q`.
+    void insert(const std::vector<units::BtuHr>& q, std::uint32_t id) {
+        auto pos = std::upper_bound(order.begin(), order.end(), id,
+            [&q](std::uint32_t a, std::uint32_t b) { return before(q, a, b); });
+        order.insert(pos, id);
+    }
+
+    // Takes row `id` out of the order, e.g. before its load changes. Call
+    // while q[id] still holds the load it was indexed with.
+    void remove(const std::vector<units::BtuHr>& q, std::uint32_t id) {
+        auto pos = std::lower_bound(order.begin(), order.end(), id,
+            [&q](std::uint32_t a, std::uint32_t b) { return before(q, a, b); });
+        if (pos != order.end() && *pos == id) order.erase(pos);
+    }
+
+    // Call before row `id` leaves `q`; later ids shift down by one.
+    void erase(const std::vector<units::BtuHr>& q, std::uint32_t id) {
+        remove(q, id);
+        for (std::uint32_t& o : order)
+            if (o > id) --o;
+    }
+};
+
+inline std::string toLower(std::string_view s) {
+    std::string out(s);
+    for (char& ch : out) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    return out;
+}
+
+// Case-insensitive prefix/substring search over the distinct item names.
+// Every suffix of every lowercased name sits in one sorted array, so a query
+// is a binary search plus a walk over the matching range. The name
+// dictionary is append-only, so the index only ever grows: a few new names
+// are inserted in place, a large batch is appended and re-sorted once.
+struct NameIndex {
+    // `head` packs the first four characters big-endian so most comparisons
+    // during sorting and search are a single integer compare.
+    struct Suffix {
+        std::uint32_t head;
+        std::uint32_t id;
+        std::uint32_t offset;
+    };
+
+    Arena text;
+    std::vector<std::string_view> lower; // lowercased name per dictionary id
+    std::vector<Suffix> suffixes;
+
+    static std::uint32_t headOf(std::string_view s) {
+        std::uint32_t h = 0;
+        for (std::size_t k = 0; k < 4; ++k)
+            h = (h << 8) | (k < s.size() ? static_cast<unsigned char>(s[k]) : 0u);
+        return h;
+    }
+
+    std::string_view view(const Suffix& s) const {
+        return lower[s.id].substr(s.offset);
+    }
+
+    bool less(const Suffix& a, const Suffix& b) const {
+        return a.head != b.head ? a.head < b.head : view(a) < view(b);
+    }
+
+    void update(const Dictionary& names) {
+        const std::size_t first = lower.size();
+        if (first == names.size()) return;
+
+        std::vector<Suffix> fresh;
+        for (std::size_t id = first; id < names.size(); ++id) {
+            lower.push_back(text.store(toLower(names[static_cast<std::uint32_t>(id)])));
+            std::string_view name(lower.back());
+            for (std::size_t off = 0; off < name.size(); ++off)
+                fresh.push_back(Suffix{ headOf(name.substr(off)), static_cast<std::uint32_t>(id), static_cast<std::uint32_t>(off) });
+        }
+
+        auto less = [this](const Suffix& a, const Suffix& b) { return this->less(a, b); };
+        if (fresh.size() * 16 < suffixes.size()) {
+            for (const Suffix& sfx : fresh)
+                suffixes.insert(std::upper_bound(suffixes.begin(), suffixes.end(), sfx, less), sfx);
+        }
+        else {
+            suffixes.insert(suffixes.end(), fresh.begin(), fresh.end());
+            std::sort(suffixes.begin(), suffixes.end(), less);
+        }
+    }
+
+    // Calls onId(name id) for each suffix starting with `pattern` (already
+    // lowercased). With prefixOnly, only whole-name prefixes count. A name
+    // containing the pattern more than once is reported more than once.
+    template <class OnId>
+    void match(std::string_view pattern, bool prefixOnly, OnId onId) const {
+        const std::uint32_t head = headOf(pattern);
+        auto it = std::lower_bound(suffixes.begin(), suffixes.end(), pattern,
+            [this, head](const Suffix& s, std::string_view p) { return s.head != head ? s.head < head : view(s) < p; });
+        for (; it != suffixes.end() && view(*it).substr(0, pattern.size()) == pattern; ++it)
+            if (!prefixOnly || it->offset == 0) onId(it->id);
+    }
+};
+
+// Project items stored column by column, so totals, summaries and scans read
+// only the columns they need. Names, zones and tags are dictionary-encoded;
+// id 0 is the empty string (unassigned) for zone and tag.
+struct Project {
+    std::vector<std::uint32_t> nameIds;
+    std::vector<calcs::Method> methods;
+    std::vector<units::BtuHr> btu_per_hr;
+    std::vector<std::uint32_t> zones;
+    std::vector<std::uint32_t> tags;
+    std::vector<double> a, b, c;            // inputs, see LoadItem
+    std::vector<std::uint32_t> assemblies;  // envelope::Library ids
+    std::vector<expr::Inputs> derived;      // formulas feeding a, b, c (ids in `formulas`)
+    Dictionary itemNames;
+    Dictionary zoneNames;
+    Dictionary tagNames;
+    LoadIndex byLoad;
+    NameIndex nameIndex;
+    envelope::Library library;
+    sizing::Catalog catalog;
+    expr::Variables vars;
+    expr::Table formulas;
+
+    // Every load is coef * ΔT for one ΔT source, or a constant. Per source the
+    // project keeps the sum of coefficients (BTU/hr per F) and of loads, so
+    // the total under changed ΔTs is one multiply-add per source instead of a
+    // pass over the items. Updated on add/erase, rebuilt by bulk edits.
+    struct LinearTotals {
+        numeric::CompensatedSum coef[calcs::DT_SOURCE_COUNT];
+        numeric::CompensatedSum load[calcs::DT_SOURCE_COUNT];
+    } linear;
+
+    // Zone and tag given to items added interactively.
+    std::string activeZone;
+    std::string activeTag;
+
+    Project() {
+        zoneNames.intern("");
+        tagNames.intern("");
+    }
+
+    std::size_t size() const { return btu_per_hr.size(); }
+    bool empty() const { return btu_per_hr.empty(); }
+
+    // Applies f to every per-row column.
+    template <class F>
+    void forEachColumn(F f) {
+        f(nameIds);
+        f(methods);
+        f(btu_per_hr);
+        f(zones);
+        f(tags);
+        f(a);
+        f(b);
+        f(c);
+        f(assemblies);
+        f(derived);
+    }
+
+    void reserve(std::size_t n) {
+        forEachColumn([n](auto& col) { col.reserve(n); });
+        byLoad.order.reserve(n);
+    }
+
+    // Appends a row straight into the columns. Names are looked up in the
+    // intern tables, so a row whose name, zone and tag are already known
+    // allocates nothing once the columns have capacity.
+    void emplace(std::string_view name, calcs::Method method, units::BtuHr q,
+        std::string_view zone, std::string_view tag,
+        double inA, double inB, double inC, std::uint32_t assembly) {
+        nameIds.push_back(itemNames.intern(name));
+        methods.push_back(method);
+        btu_per_hr.push_back(q);
+        zones.push_back(zoneNames.intern(zone));
+        tags.push_back(tagNames.intern(tag));
+        a.push_back(inA);
+        b.push_back(inB);
+        c.push_back(inC);
+        assemblies.push_back(assembly);
+        derived.emplace_back();
+        if (!byLoad.stale) byLoad.insert(btu_per_hr, static_cast<std::uint32_t>(size() - 1));
+        accumulateLinear(size() - 1, 1.0);
+    }
+
+    void add(const LoadItem& item) {
+        emplace(item.name, item.method, item.btu_per_hr, item.zone, item.tag, item.a, item.b, item.c, item.assembly);
+    }
+
+    void erase(std::size_t i) {
+        if (!byLoad.stale) byLoad.erase(btu_per_hr, static_cast<std::uint32_t>(i));
+        accumulateLinear(i, -1.0);
+        forEachColumn([i](auto& col) { col.erase(col.begin() + i); });
+    }
+
+    // Replaces row i in place, keeping the load index and per-source totals
+    // in step. The new inputs are taken as typed.
+    void set(std::size_t i, const LoadItem& item) {
+        if (!byLoad.stale) byLoad.remove(btu_per_hr, static_cast<std::uint32_t>(i));
+        accumulateLinear(i, -1.0);
+        nameIds[i] = itemNames.intern(item.name);
+        methods[i] = item.method;
+        btu_per_hr[i] = item.btu_per_hr;
+        zones[i] = zoneNames.intern(item.zone);
+        tags[i] = tagNames.intern(item.tag);
+        a[i] = item.a;
+        b[i] = item.b;
+        c[i] = item.c;
+        assemblies[i] = item.assembly;
+        derived[i] = expr::Inputs();
+        accumulateLinear(i, 1.0);
+        if (!byLoad.stale) byLoad.insert(btu_per_hr, static_cast<std::uint32_t>(i));
+    }
+
+    // Inserts items so the first becomes row `at`. They are appended and
+    // rotated into place column by column; the load index is left stale for
+    // the next query to rebuild, as after an import.
+    void insert(std::size_t at, const std::vector<LoadItem>& items) {
+        const std::size_t old = size();
+        byLoad.stale = true;
+        reserve(old + items.size());
+        for (const LoadItem& item : items) add(item);
+        if (at < old)
+            forEachColumn([at, old](auto& col) { std::rotate(col.begin() + at, col.begin() + old, col.end()); });
+    }
+
+    // Load per F of the row's ΔT. Taken from the stored load so it carries
+    // the air/fluid factor the row was evaluated with; a row entered at
+    // ΔT = 0 falls back to the standard factors.
+    double dtCoefficient(std::size_t i) const {
+        int col = calcs::dtColumn(methods[i]);
+        if (!col) return 0.0;
+        double dT = (col == 1) ? b[i] : c[i];
+        if (dT != 0.0) return btu_per_hr[i].value / dT;
+        return calcs::STANDARD_BATCH.k[static_cast<int>(methods[i])] * a[i] * (col == 2 ? b[i] : 1.0);
+    }
+
+    void accumulateLinear(std::size_t i, double sign) {
+        int s = static_cast<int>(calcs::dtSource(methods[i]));
+        linear.coef[s].add(sign * dtCoefficient(i));
+        linear.load[s].add(sign * btu_per_hr[i].value);
+    }
+
+    void rebuildLinear() {
+        linear = LinearTotals();
+        for (std::size_t i = 0; i < size(); ++i) accumulateLinear(i, 1.0);
+    }
+
+    // Sum of coefficients for one ΔT source, e.g. the project UA for
+    // DtSource::Outdoor.
+    double coefficient(calcs::DtSource s) const { return linear.coef[static_cast<int>(s)].result(); }
+
+    units::BtuHr sourceLoad(calcs::DtSource s) const { return units::BtuHr(linear.load[static_cast<int>(s)].result()); }
+
+    // Project total with every row's ΔT shifted by shift[source] (F).
+    units::BtuHr totalWithShift(const double (&shift)[calcs::DT_SOURCE_COUNT]) const {
+        numeric::CompensatedSum t;
+        for (int s = 0; s < calcs::DT_SOURCE_COUNT; ++s) {
+            t.add(linear.load[s].result());
+            t.add(shift[s] * linear.coef[s].result());
+        }
+        return units::BtuHr(t.result());
+    }
+
+    // Removes every row with drop[i] set in one pass over each column. Rows
+    // keep their relative order and the load index is remapped, not rebuilt.
+    std::size_t compact(const std::vector<std::uint8_t>& drop) {
+        const std::size_t n = size();
+        std::vector<std::uint32_t> newId(n);
+        std::uint32_t k = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            newId[i] = k;
+            k += !drop[i];
+        }
+        if (k == n) return 0;
+
+        auto squeeze = [&](auto& col) {
+            std::size_t w = 0;
+            for (std::size_t i = 0; i < n; ++i)
+                if (!drop[i]) col[w++] = std::move(col[i]);
+            col.resize(w);
+        };
+        forEachColumn(squeeze);
+
+        if (!byLoad.stale) {
+            std::size_t w = 0;
+            for (std::uint32_t id : byLoad.order)
+                if (!drop[id]) byLoad.order[w++] = newId[id];
+            byLoad.order.resize(w);
+        }
+        rebuildLinear();
+        return n - k;
+    }
+
+    void setName(const std::vector<std::uint32_t>& rows, const std::string& name) {
+        std::uint32_t id = itemNames.intern(name);
+        for (std::uint32_t i : rows) nameIds[i] = id;
+    }
+
+    void setZone(const std::vector<std::uint32_t>& rows, const std::string& zone) {
+        std::uint32_t id = zoneNames.intern(zone);
+        for (std::uint32_t i : rows) zones[i] = id;
+    }
+
+    void setTag(const std::vector<std::uint32_t>& rows, const std::string& tag) {
+        std::uint32_t id = tagNames.intern(tag);
+        for (std::uint32_t i : rows) tags[i] = id;
+    }
+
+    std::string_view name(std::size_t i) const { return itemNames[nameIds[i]]; }
+
+    // Re-evaluates every surface that references an assembly after the
+    // library changed: gather U by id, then multiply by area and dT.
+    void reevaluateAssemblies() {
+        const std::size_t n = size();
+        envelope::gatherU(library, assemblies.data(), a.data(), n);
+        for (std::size_t i = 0; i < n; ++i)
+            if (assemblies[i]) btu_per_hr[i] = units::BtuHr(a[i] * b[i] * c[i]);
+        byLoad.stale = true;
+        rebuildLinear();
+    }
+
+    // Re-runs every formula against the current variables and re-evaluates
+    // the rows they feed. Returns the number of rows.
+    std::size_t reevaluateFormulas(const calcs::BatchFactors& f) {
+        formulas.evaluate(vars);
+        const double* value = formulas.values.data();
+        std::vector<std::uint32_t> rows;
+        for (std::size_t i = 0; i < size(); ++i)
+            if (derived[i].any()) rows.push_back(static_cast<std::uint32_t>(i));
+        if (rows.empty()) return 0;
+
+        double* in[3] = { a.data(), b.data(), c.data() };
+        std::vector<calcs::Method> m(rows.size());
+        std::vector<double> ra(rows.size()), rb(rows.size()), rc(rows.size()), q(rows.size());
+        for (std::size_t j = 0; j < rows.size(); ++j) {
+            const std::uint32_t i = rows[j];
+            for (int k = 0; k < 3; ++k)
+                if (derived[i].id[k]) in[k][i] = value[derived[i].id[k]];
+            m[j] = methods[i];
+            ra[j] = a[i];
+            rb[j] = b[i];
+            rc[j] = c[i];
+        }
+        calcs::evaluate_batch(m.data(), ra.data(), rb.data(), rc.data(), q.data(), rows.size(), f);
+        for (std::size_t j = 0; j < rows.size(); ++j) btu_per_hr[rows[j]] = units::BtuHr(q[j]);
+        byLoad.stale = true;
+        rebuildLinear();
+        return rows.size();
+    }
+
+    // Drops all items and variables; the assembly library and equipment
+    // catalog are kept for the next project.
+    void clear() {
+        envelope::Library keepLibrary = std::move(library);
+        sizing::Catalog keepCatalog = std::move(catalog);
+        *this = Project();
+        library = std::move(keepLibrary);
+        catalog = std::move(keepCatalog);
+    }
+
+    LoadItem row(std::size_t i) const {
+        LoadItem item;
+        item.name = name(i);
+        item.method = methods[i];
+        item.btu_per_hr = btu_per_hr[i];
+        item.zone = zoneNames[zones[i]];
+        item.tag = tagNames[tags[i]];
+        item.a = a[i];
+        item.b = b[i];
+        item.c = c[i];
+        item.assembly = assemblies[i];
+        return item;
+    }
+};
+
+// Project total through the deterministic reduction, so it does not change
+// with thread count and drifts by at most an ulp when items are reordered.
+units::BtuHr totalLoad(const Project& p) {
+    const std::vector<units::BtuHr>& q = p.btu_per_hr;
+    return units::BtuHr(numeric::sumIndexed(q.size(), [&q](std::size_t i) { return q[i].value; }));
+}
+
+namespace query {
+
+    enum class GroupBy { Method, Zone, Tag };
+
+    struct GroupRow {
+        std::string key;
+        std::size_t count = 0;
+        units::BtuHr total;
+        units::BtuHr min;
+        units::BtuHr max;
+        double share = 0.0; // fraction of the project total
+    };
+
+    struct GroupAcc {
+        std::size_t count = 0;
+        numeric::CompensatedSum sum;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+
+        void merge(const GroupAcc& o) {
+            count += o.count;
+            sum.merge(o.sum);
+            min = std::min(min, o.min);
+            max = std::max(max, o.max);
+        }
+    };
+
+    // Large projects are cut into a fixed number of chunks so the merged sums
+    // are the same on any machine.
+    constexpr std::size_t GROUP_CHUNKS = 16;
+
+    // One pass over a key column and the load column. Keys are dense ids
+    // (method code or dictionary id), so the aggregation table is a flat
+    // array indexed by key: a collision-free hash with no probing.
+    template <class Key>
+    std::vector<GroupAcc> aggregate(const std::vector<Key>& key, const std::vector<units::BtuHr>& q,
+        std::size_t groups) {
+        const std::size_t n = q.size();
+        const std::size_t chunks = (n >= numeric::PARALLEL_MIN) ? GROUP_CHUNKS : 1;
+        std::vector<std::vector<GroupAcc>> partial(chunks, std::vector<GroupAcc>(groups));
+
+        numeric::parallelFor(chunks, chunks > 1, [&](std::size_t c) {
+            std::vector<GroupAcc>& acc = partial[c];
+            std::size_t end = n * (c + 1) / chunks;
+            for (std::size_t i = n * c / chunks; i < end; ++i) {
+                GroupAcc& g = acc[static_cast<std::size_t>(key[i])];
+                double v = q[i].value;
+                ++g.count;
+                g.sum.add(v);
+                g.min = std::min(g.min, v);
+                g.max = std::max(g.max, v);
+            }
+        });
+
+        for (std::size_t c = 1; c < chunks; ++c)
+            for (std::size_t g = 0; g < groups; ++g) partial[0][g].merge(partial[c][g]);
+        return partial[0];
+    }
+
+    // Count, sum, min, max and share per group, largest total first.
+    std::vector<GroupRow> groupBy(const Project& p, GroupBy by) {
+        std::vector<GroupAcc> acc;
+        const Dictionary* dict = nullptr;
+        if (by == GroupBy::Method) {
+            acc = aggregate(p.methods, p.btu_per_hr, calcs::METHOD_COUNT);
+        }
+        else if (by == GroupBy::Zone) {
+            acc = aggregate(p.zones, p.btu_per_hr, p.zoneNames.size());
+            dict = &p.zoneNames;
+        }
+        else {
+            acc = aggregate(p.tags, p.btu_per_hr, p.tagNames.size());
+            dict = &p.tagNames;
+        }
+
+        numeric::CompensatedSum all;
+        for (const GroupAcc& g : acc) all.merge(g.sum);
+        const double total = all.result();
+
+        std::vector<GroupRow> rows;
+        for (std::size_t id = 0; id < acc.size(); ++id) {
+            if (acc[id].count == 0) continue;
+            GroupRow row;
+            if (dict) row.key = (*dict)[static_cast<std::uint32_t>(id)].empty() ? "(none)" : (*dict)[static_cast<std::uint32_t>(id)];
+            else row.key = calcs::methodLabel(static_cast<calcs::Method>(id));
+            row.count = acc[id].count;
+            row.total = units::BtuHr(acc[id].sum.result());
+            row.min = units::BtuHr(acc[id].min);
+            row.max = units::BtuHr(acc[id].max);
+            row.share = (total != 0.0) ? row.total.value / total : 0.0;
+            rows.push_back(row);
+        }
+        std::sort(rows.begin(), rows.end(),
+            [](const GroupRow& a, const GroupRow& b) { return a.total > b.total; });
+        return rows;
+    }
+
+    // The k largest loads, largest first: the first k entries of the load
+    // index. A stale index (after an import or bulk edit) is rebuilt once
+    // here, so later queries cost O(k) until the next bulk change.
+    std::vector<std::uint32_t> topN(Project& p, std::size_t k) {
+        if (p.byLoad.stale) p.byLoad.rebuild(p.btu_per_hr);
+        k = std::min(k, p.byLoad.order.size());
+        return std::vector<std::uint32_t>(p.byLoad.order.begin(), p.byLoad.order.begin() + k);
+    }
+
+    enum class NameMatch { Prefix, Substring };
+
+    // Rows whose name starts with / contains `pattern`, case-insensitive, in
+    // project order. Matching names come from the suffix index; one scan of
+    // the name-id column against a per-name hit mask turns them into rows.
+    std::vector<std::uint32_t> findByName(Project& p, const std::string& pattern, NameMatch mode) {
+        p.nameIndex.update(p.itemNames);
+
+        std::vector<std::uint8_t> hit(p.itemNames.size(), 0);
+        bool any = false;
+        const std::string lowered = toLower(pattern);
+        p.nameIndex.match(lowered, mode == NameMatch::Prefix, [&](std::uint32_t id) { hit[id] = 1; any = true; });
+
+        std::vector<std::uint32_t> rows;
+        if (!any) return rows;
+        for (std::size_t i = 0; i < p.size(); ++i)
+            if (hit[p.nameIds[i]]) rows.push_back(static_cast<std::uint32_t>(i));
+        return rows;
+    }
+
+    // Rows with load >= threshold, in project order. The count pass is a
+    // plain compare-and-add the compiler vectorizes; the fill pass stores
+    // every index and advances only on a match, so neither pass branches.
+    std::vector<std::uint32_t> atLeast(const Project& p, units::BtuHr threshold) {
+        const units::BtuHr* q = p.btu_per_hr.data();
+        const std::size_t n = p.size();
+        const double t = threshold.value;
+
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; ++i) count += (q[i].value >= t);
+
+        std::vector<std::uint32_t> out(count + 1);
+        std::size_t k = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            out[k] = static_cast<std::uint32_t>(i);
+            k += (q[i].value >= t);
+        }
+        out.resize(count);
+        return out;
+    }
+
+} // namespace query
+
+namespace bulk {
+
+    // Bulk edits build a drop mask first and then apply it with one
+    // Project::compact, so removing k of n items is O(n) instead of k
+    // vector erases.
+
+    // Marks 1-based item numbers given as "3-10,15,20-25". Returns false and
+    // leaves `drop` unspecified on a malformed or out-of-range spec.
+    bool markRanges(const std::string& spec, std::vector<std::uint8_t>& drop) {
+        const std::size_t n = drop.size();
+        std::stringstream ss(spec);
+        std::string part;
+        bool any = false;
+        while (std::getline(ss, part, ',')) {
+            if (part.find_first_not_of(" ") == std::string::npos) continue;
+            unsigned long lo = 0, hi = 0;
+            char dash = 0;
+            std::istringstream ps(part);
+            if (!(ps >> lo)) return false;
+            hi = lo;
+            if (ps >> dash) {
+                if (dash != '-' || !(ps >> hi)) return false;
+            }
+            if (lo < 1 || hi < lo || hi > n) return false;
+            std::fill(drop.begin() + (lo - 1), drop.begin() + hi, std::uint8_t(1));
+            any = true;
+        }
+        return any;
+    }
+
+    void markMethod(const Project& p, calcs::Method m, std::vector<std::uint8_t>& drop) {
+        const calcs::Method* col = p.methods.data();
+        for (std::size_t i = 0; i < p.size(); ++i) drop[i] |= static_cast<std::uint8_t>(col[i] == m);
+    }
+
+    void markRows(const std::vector<std::uint32_t>& rows, std::vector<std::uint8_t>& drop) {
+        for (std::uint32_t i : rows) drop[i] = 1;
+    }
+
+    // Scales the first input (CFM, GPM, U or ACH) of every item of a method.
+    // Loads are linear in it, so the load scales by the same k. Applied as
+    // one branch-free pass over the input and load columns; the load index is
+    // re-sorted on next use. A scaled input that came from a formula becomes
+    // typed, so re-evaluating formulas does not undo the scaling.
+    std::size_t scaleMethod(Project& p, calcs::Method m, double k) {
+        const calcs::Method* col = p.methods.data();
+        units::BtuHr* q = p.btu_per_hr.data();
+        double* in = p.a.data();
+        expr::Inputs* link = p.derived.data();
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < p.size(); ++i) {
+            bool hit = (col[i] == m);
+            double f = hit ? k : 1.0;
+            q[i] = q[i] * f;
+            in[i] *= f;
+            link[i].id[0] = hit ? 0 : link[i].id[0];
+            count += hit;
+        }
+        if (count) {
+            p.byLoad.stale = true;
+            p.rebuildLinear();
+        }
+        return count;
+    }
+
+} // namespace bulk
+
+namespace props {
+
+    // ------------------------ AIR ------------------------
+
+    // Density of air relative to the 1.08 basis (0.075 lb/ft³: sea level, 70 F).
+    // The altitude part is the standard atmosphere
+    //   rho/rho0 = (1 - 6.8754e-6 * z[ft])^5.2559
+    // tabulated every 250 ft up to 20,000 ft and interpolated linearly (error
+    // under 0.01% against the formula), so no pow() per call.
+    constexpr double ALT_STEP_FT = 250.0;
+    constexpr int ALT_POINTS = 81;
+    constexpr double ALT_MAX_FT = ALT_STEP_FT * (ALT_POINTS - 1);
+    constexpr double RANKINE_OFFSET = 459.67;
+    constexpr double STANDARD_AIR_TEMP_F = 70.0;
+
+    const std::array<double, ALT_POINTS>& altitudeTable() {
+        static const std::array<double, ALT_POINTS> table = [] {
+            std::array<double, ALT_POINTS> t{};
+            for (int i = 0; i < ALT_POINTS; ++i)
+                t[i] = std::pow(1.0 - 6.8754e-6 * (i * ALT_STEP_FT), 5.2559);
+            return t;
+        }();
+        return table;
+    }
+
+    double air_density_ratio(double altitude_ft) {
+        const std::array<double, ALT_POINTS>& t = altitudeTable();
+        if (altitude_ft <= 0.0) return t[0];
+        if (altitude_ft >= ALT_MAX_FT) return t[ALT_POINTS - 1];
+        double x = altitude_ft / ALT_STEP_FT;
+        int i = static_cast<int>(x);
+        double f = x - i;
+        return t[i] + f * (t[i + 1] - t[i]);
+    }
+
+    // 1.08 corrected for site altitude and for the air temperature at the
+    // point where the CFM is measured (ideal gas, rho ~ 1/T).
+    units::AirFactor air_sensible_factor(double altitude_ft, units::DegF airTemp) {
+        double tempRatio = (STANDARD_AIR_TEMP_F + RANKINE_OFFSET) / (airTemp.value + RANKINE_OFFSET);
+        return calcs::STANDARD_AIR * (air_density_ratio(altitude_ft) * tempRatio);
+    }
+
+    // ------------------------ FLUIDS ------------------------
+
+    enum class Fluid { Water, PropyleneGlycol, EthyleneGlycol };
+    constexpr int FLUID_COUNT = 3;
+
+    inline const char* fluidName(Fluid f) {
+        static const char* const names[FLUID_COUNT] = { "Water", "Propylene glycol", "Ethylene glycol" };
+        return names[static_cast<int>(f)];
+    }
+
+    // Hydronic factor 60 * rho[lb/gal] * cp[BTU/lb·F] in BTU/hr per GPM·F,
+    // tabulated by concentration (% by volume) and fluid temperature. Values
+    // are rounded from typical manufacturer property charts (about ±1%); the
+    // 0% row is plain water and is shared by both glycols.
+    constexpr int GLYCOL_PCT_POINTS = 5;
+    constexpr int FLUID_TEMP_POINTS = 5;
+    constexpr double GLYCOL_PCT[GLYCOL_PCT_POINTS] = { 0.0, 20.0, 30.0, 40.0, 50.0 };
+    constexpr double FLUID_TEMP_F[FLUID_TEMP_POINTS] = { 40.0, 80.0, 120.0, 160.0, 200.0 };
+
+    constexpr double FLUID_FACTOR[FLUID_COUNT][GLYCOL_PCT_POINTS][FLUID_TEMP_POINTS] = {
+        { // Water (concentration ignored)
+            { 502.8, 498.1, 494.5, 489.8, 484.1 },
+            { 502.8, 498.1, 494.5, 489.8, 484.1 },
+            { 502.8, 498.1, 494.5, 489.8, 484.1 },
+            { 502.8, 498.1, 494.5, 489.8, 484.1 },
+            { 502.8, 498.1, 494.5, 489.8, 484.1 },
+        },
+        { // Propylene glycol
+            { 502.8, 498.1, 494.5, 489.8, 484.1 },
+            { 485.1, 484.5, 483.1, 481.7, 479.5 },
+            { 474.4, 474.5, 473.7, 473.7, 472.8 },
+            { 458.3, 460.4, 462.4, 465.0, 466.7 },
+            { 440.4, 444.0, 447.5, 451.5, 454.7 },
+        },
+        { // Ethylene glycol
+            { 502.8, 498.1, 494.5, 489.8, 484.1 },
+            { 487.6, 486.4, 485.1, 483.8, 482.4 },
+            { 467.8, 468.9, 470.8, 472.2, 473.5 },
+            { 447.2, 449.1, 452.7, 456.9, 458.4 },
+            { 420.1, 424.9, 428.8, 433.4, 437.7 },
+        },
+    };
+
+    // Clamped bracket search over a short ascending axis.
+    inline void bracket(const double* axis, int n, double x, int& i, double& f) {
+        if (x <= axis[0]) { i = 0; f = 0.0; return; }
+        if (x >= axis[n - 1]) { i = n - 2; f = 1.0; return; }
+        i = 0;
+        while (x > axis[i + 1]) ++i;
+        f = (x - axis[i]) / (axis[i + 1] - axis[i]);
+    }
+
+    // Bilinear lookup in FLUID_FACTOR. Inputs outside the table are clamped.
+    units::FluidFactor hydronic_factor(Fluid fluid, double glycolPct, units::DegF fluidTemp) {
+        int ic, it;
+        double fc, ft;
+        bracket(GLYCOL_PCT, GLYCOL_PCT_POINTS, glycolPct, ic, fc);
+        bracket(FLUID_TEMP_F, FLUID_TEMP_POINTS, fluidTemp.value, it, ft);
+
+        const auto& t = FLUID_FACTOR[static_cast<int>(fluid)];
+        double lo = t[ic][it] + ft * (t[ic][it + 1] - t[ic][it]);
+        double hi = t[ic + 1][it] + ft * (t[ic + 1][it + 1] - t[ic + 1][it]);
+        return units::FluidFactor(lo + fc * (hi - lo));
+    }
+
+} // namespace props
+
+namespace psychro {
+
+    // Moist-air properties in IP units (ASHRAE Fundamentals, ch. 1): dry-bulb
+    // in F, pressures in psia, humidity ratio in lb/lb, enthalpy in BTU/lb of
+    // dry air. The *_ref functions are the Hyland-Wexler correlations as
+    // published; the *_fast ones replace the exp/log with a table and are
+    // meant for hourly loops over whole buildings.
+
+    constexpr double P_SEA_LEVEL_PSIA = 14.696;
+    constexpr double EPSILON = 0.621945;  // molar mass ratio water / dry air
+
+    // Standard-atmosphere pressure. Same (1 - 6.8754e-6 z)^5.2559 curve that
+    // props tabulates, so no pow() here either.
+    double pressure_psia(double altitude_ft) {
+        return P_SEA_LEVEL_PSIA * props::air_density_ratio(altitude_ft);
+    }
+
+    // Saturation pressure over ice (below 32 F) and over liquid water.
+    double pws_ice_ref(double t_f) {
+        double T = t_f + props::RANKINE_OFFSET;
+        return std::exp(-1.0214165e4 / T - 4.8932428 - 5.3765794e-3 * T + 1.9202377e-7 * T * T
+            + 3.5575832e-10 * T * T * T - 9.0344688e-14 * T * T * T * T + 4.1635019 * std::log(T));
+    }
+
+    double pws_water_ref(double t_f) {
+        double T = t_f + props::RANKINE_OFFSET;
+        return std::exp(-1.0440397e4 / T - 1.1294650e1 - 2.7022355e-2 * T + 1.2890360e-5 * T * T
+            - 2.4780681e-9 * T * T * T + 6.5459673 * std::log(T));
+    }
+
+    double saturation_pressure_ref(units::DegF t) {
+        return t.value < 32.0 ? pws_ice_ref(t.value) : pws_water_ref(t.value);
+    }
+
+    // W = 0.621945 * pw / (p - pw)
+    constexpr double humidity_ratio_from_pw(double pw, double p) {
+        return EPSILON * pw / (p - pw);
+    }
+
+    // Water vapour partial pressure back out of a humidity ratio.
+    constexpr double pw_from_humidity_ratio(units::HumRatio w, double p) {
+        return p * w.value / (EPSILON + w.value);
+    }
+
+    // h = 0.240 t + W (1061 + 0.444 t). Polynomial already, so there is no
+    // separate fast form.
+    constexpr double enthalpy(units::DegF t, units::HumRatio w) {
+        return 0.240 * t.value + w.value * (1061.0 + 0.444 * t.value);
+    }
+
+    units::HumRatio humidity_ratio_ref(units::DegF t, double rh, double p) {
+        return units::HumRatio(humidity_ratio_from_pw(rh * saturation_pressure_ref(t), p));
+    }
+
+    // ------------------------ FAST ------------------------
+
+    // Piecewise cubic over 1 F intervals from -60 F to 200 F. Each interval
+    // stores the Hermite polynomial through the reference values and slopes
+    // at its ends, taken from the phase that owns the interval so the kink at
+    // 32 F falls on a node. Relative error against saturation_pressure_ref is
+    // below 5e-8 over the range (worst at the cold end, where the Hermite bound
+    // h^4/384 * |f''''/f| is largest); outside it the table is clamped, so use
+    // the reference form there. One table lookup and four multiply-adds a call.
+    constexpr double PWS_T_MIN = -60.0;
+    constexpr double PWS_T_MAX = 200.0;
+    constexpr int PWS_INTERVALS = 260;
+
+    struct PwsCubic { double c0, c1, c2, c3; };
+
+    const std::array<PwsCubic, PWS_INTERVALS>& pwsTable() {
+        static const std::array<PwsCubic, PWS_INTERVALS> table = [] {
+            std::array<PwsCubic, PWS_INTERVALS> t{};
+            const double h = 1e-3;
+            for (int i = 0; i < PWS_INTERVALS; ++i) {
+                double t0 = PWS_T_MIN + i;
+                double (*f)(double) = (t0 < 32.0) ? pws_ice_ref : pws_water_ref;
+                double y0 = f(t0), y1 = f(t0 + 1.0);
+                double d0 = (f(t0 + h) - f(t0 - h)) / (2.0 * h);
+                double d1 = (f(t0 + 1.0 + h) - f(t0 + 1.0 - h)) / (2.0 * h);
+                t[i] = { y0, d0, 3.0 * (y1 - y0) - 2.0 * d0 - d1, 2.0 * (y0 - y1) + d0 + d1 };
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    inline double pws_fast(const PwsCubic* table, double t_f) {
+        double x = std::min(std::max(t_f, PWS_T_MIN), PWS_T_MAX) - PWS_T_MIN;
+        int i = std::min(static_cast<int>(x), PWS_INTERVALS - 1);
+        double u = x - i;
+        const PwsCubic& c = table[i];
+        return c.c0 + u * (c.c1 + u * (c.c2 + u * c.c3));
+    }
+
+    double saturation_pressure_fast(units::DegF t) {
+        return pws_fast(pwsTable().data(), t.value);
+    }
+
+    units::HumRatio humidity_ratio_fast(units::DegF t, double rh, double p) {
+        return units::HumRatio(humidity_ratio_from_pw(rh * saturation_pressure_fast(t), p));
+    }
+
+    // Whole hourly columns at a time: a counted loop with no calls to libm,
+    // which the compiler can unroll and vectorize apart from the table gather.
+    void humidity_ratio_fast(const double* t_f, const double* rh, double p, double* w, std::size_t n) {
+        const PwsCubic* table = pwsTable().data();
+        for (std::size_t i = 0; i < n; ++i) {
+            double pw = rh[i] * pws_fast(table, t_f[i]);
+            w[i] = EPSILON * pw / (p - pw);
+        }
+    }
+
+    void enthalpy(const double* t_f, const double* w, double* h, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i)
+            h[i] = 0.240 * t_f[i] + w[i] * (1061.0 + 0.444 * t_f[i]);
+    }
+
+} // namespace psychro
+
+namespace energy {
+
+    // ------------------------ DEGREE-HOURS ------------------------
+
+    // Heating and cooling degree-hours for any number of base temperatures
+    // from a single pass over an hourly weather series. Each hour goes into a
+    // 0.1 F bin that keeps its count and temperature sum; after finish(),
+    // prefix sums give, for a base b on the bin grid,
+    //   heating(b) = sum over T < b  of (b - T) = b * n_below - sum_below
+    //   cooling(b) = sum over T >= b of (T - b) = sum_above - b * n_above
+    // exactly, so asking for another base costs O(1) and never rereads the
+    // file. Hours outside -80..140 F go into end bins and still count exactly;
+    // bases are clamped to that range and rounded to 0.1 F.
+    constexpr double DH_MIN_F = -80.0;
+    constexpr double DH_MAX_F = 140.0;
+    constexpr int DH_BINS_PER_F = 10;
+    constexpr int DH_BINS = static_cast<int>((DH_MAX_F - DH_MIN_F) * DH_BINS_PER_F);
+
+    struct DegreeHours {
+        std::vector<double> count = std::vector<double>(DH_BINS + 2, 0.0); // [0] below range, [DH_BINS+1] above
+        std::vector<double> sum = std::vector<double>(DH_BINS + 2, 0.0);
+        std::vector<double> cumCount, cumSum; // prefix sums, filled by finish()
+        std::size_t hours = 0;
+
+        static int binOf(double t_f) {
+            double x = std::floor((t_f - DH_MIN_F) * DH_BINS_PER_F) + 1.0;
+            return static_cast<int>(std::min(std::max(x, 0.0), static_cast<double>(DH_BINS + 1)));
+        }
+
+        void add(units::DegF t) {
+            int k = binOf(t.value);
+            count[k] += 1.0;
+            sum[k] += t.value;
+            ++hours;
+        }
+
+        void finish() {
+            cumCount.assign(DH_BINS + 3, 0.0);
+            cumSum.assign(DH_BINS + 3, 0.0);
+            for (int k = 0; k < DH_BINS + 2; ++k) {
+                cumCount[k + 1] = cumCount[k] + count[k];
+                cumSum[k + 1] = cumSum[k] + sum[k];
+            }
+        }
+
+        // Number of leading bins that hold only hours colder than `base`.
+        static int split(units::DegF& base) {
+            double tenths = std::round((base.value - DH_MIN_F) * DH_BINS_PER_F);
+            tenths = std::min(std::max(tenths, 0.0), static_cast<double>(DH_BINS));
+            base = units::DegF(DH_MIN_F + tenths / DH_BINS_PER_F);
+            return static_cast<int>(tenths) + 1;
+        }
+
+        double heating(units::DegF base) const {
+            int k = split(base);
+            return base.value * cumCount[k] - cumSum[k];
+        }
+
+        double cooling(units::DegF base) const {
+            int k = split(base);
+            return (cumSum[DH_BINS + 2] - cumSum[k]) - base.value * (cumCount[DH_BINS + 2] - cumCount[k]);
+        }
+    };
+
+    // ------------------------ ANNUAL ENERGY ------------------------
+
+    constexpr double BTU_PER_THERM = 100000.0;
+
+    // Annual heat moved (BTU) = UA * degree-hours, with UA the project's
+    // outdoor-ΔT coefficient. Hydronic loops only move heat that those items
+    // already count, and the cooling gains do not scale with ΔT.
+    constexpr double annual_btu(double ua, double degreeHours) { return ua * degreeHours; }
+
+    // Fuel input at the given seasonal efficiency (0.9 = 90% AFUE).
+    constexpr double therms(double btu, double efficiency) { return btu / (BTU_PER_THERM * efficiency); }
+
+    // Electric input at the given seasonal COP.
+    constexpr double kwh(double btu, double cop) { return btu / (units::BTU_PER_HR_PER_KW * cop); }
+
+} // namespace energy
+
+// Session-wide calculation settings chosen from the main menu. The factors
+// start at the textbook 1.08 and 500 and are only replaced when site
+// conditions are entered, so they are resolved once rather than per item.
+struct Settings {
+    units::System system = units::System::Imperial;
+    units::AirFactor airFactor = calcs::STANDARD_AIR;
+    units::FluidFactor fluidFactor = calcs::STANDARD_WATER;
+    bool memoize = true; // reuse formatted output for repeated loads
+};
+
+namespace memo {
+
+    struct Stats {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+
+        double hitRate() const {
+            std::uint64_t n = hits + misses;
+            return n ? static_cast<double>(hits) / static_cast<double>(n) : 0.0;
+        }
+    };
+
+    inline std::uint64_t keyOf(double x) {
+        std::uint64_t k;
+        std::memcpy(&k, &x, sizeof k);
+        return k;
+    }
+
+    // 64-bit content hash, eight bytes per step with a multiply-xorshift mix.
+    // Not cryptographic; used to recognise unchanged inputs.
+    inline std::uint64_t hashBytes(const char* p, std::size_t n, std::uint64_t seed = 0) {
+        constexpr std::uint64_t M = 0x9e3779b97f4a7c15ULL;
+        std::uint64_t h = seed ^ (n * M);
+        auto step = [&h](std::uint64_t w) {
+            h ^= w * M;
+            h = (h << 31) | (h >> 33);
+            h *= 0xbf58476d1ce4e5b9ULL;
+        };
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            std::uint64_t w;
+            std::memcpy(&w, p + i, 8);
+            step(w);
+        }
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, p + i, n - i);
+        step(tail);
+        h ^= h >> 29;
+        h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 32);
+    }
+
+    // Bounded open-addressing cache from an exact 64-bit key to a short
+    // formatted string. Each slot is one cache line with the text inline, so
+    // a hit is a hash, a compare and a copy, with no allocation. A key probes
+    // PROBE slots from its home; when all hold other keys the home slot is
+    // overwritten, so the table never grows past its capacity. Meant to be
+    // owned by one thread (one per worker), which keeps reads free of locks.
+    class TextCache {
+    public:
+        static constexpr std::size_t PROBE = 8;
+
+        // Capacity is rounded up to a power of two; 0 disables caching.
+        explicit TextCache(std::size_t capacity) {
+            if (capacity == 0) return;
+            std::size_t n = PROBE;
+            while (n < capacity) n *= 2;
+            slots.assign(n, Slot());
+        }
+
+        // Text for `key`, calling format(std::string&) to produce it on a
+        // miss. The view is valid until the next call.
+        template <class Format>
+        std::string_view get(std::uint64_t key, Format format) {
+            if (slots.empty()) {
+                scratch.clear();
+                format(scratch);
+                return scratch;
+            }
+
+            const std::size_t mask = slots.size() - 1;
+            const std::size_t home = static_cast<std::size_t>(mix(key)) & mask;
+            Slot* target = nullptr;
+            for (std::size_t k = 0; k < PROBE; ++k) {
+                Slot& s = slots[(home + k) & mask];
+                if (s.len && s.key == key) {
+                    ++counts.hits;
+                    return std::string_view(s.text, s.len);
+                }
+                if (!s.len && !target) target = &s;
+            }
+
+            ++counts.misses;
+            scratch.clear();
+            format(scratch);
+            if (scratch.empty() || scratch.size() > sizeof(Slot::text)) return scratch; // too long to keep
+            if (!target) target = &slots[home];
+            target->key = key;
+            target->len = static_cast<std::uint8_t>(scratch.size());
+            std::memcpy(target->text, scratch.data(), scratch.size());
+            return std::string_view(target->text, target->len);
+        }
+
+        const Stats& stats() const { return counts; }
+
+    private:
+        struct Slot {
+            std::uint64_t key = 0;
+            std::uint8_t len = 0; // 0 = empty
+            char text[55];
+        };
+        static_assert(sizeof(Slot) == 64, "one slot per cache line");
+
+        // splitmix64 finalizer: neighbouring doubles differ only in low
+        // mantissa bits, so they need mixing before masking.
+        static std::uint64_t mix(std::uint64_t x) {
+            x ^= x >> 30;
+            x *= 0xbf58476d1ce4e5b9ULL;
+            x ^= x >> 27;
+            x *= 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        }
+
+        std::vector<Slot> slots;
+        std::string scratch;
+        Stats counts;
+    };
+
+} // namespace memo
+
+namespace ui {
+
+    void printHeader() {
+        std::cout << "=============================================\n";
+        std::cout << " HEAT LOAD CALCULATOR (Console) - Imperial / SI\n";
+        std::cout << " Methods: Air Sensible | Hydronic | Conduction | ACH\n";
+        std::cout << "          Solar | Internal Gains | Latent (cooling)\n";
+        std::cout << "---------------------------------------------\n";
+        std::cout << " Notes:\n";
+        std::cout << "  - Quick-calcs intended for preliminary sizing.\n";
+        std::cout << "  - Verify assumptions, code requirements, and design standards.\n";
+        std::cout << "=============================================\n\n";
+    }
+
+    // Formula constants (1.08, 500, corrected factors) for result echo lines,
+    // without disturbing the stream's fixed/precision state.
+    std::string formatCoef(double k) {
+        std::ostringstream os;
+        os << std::setprecision(4) << k;
+        return os.str();
+    }
+
+    // Load columns after the Name/Method columns: BTU/hr, kW, Tons in imperial
+    // mode; W, kW in SI mode. Items are always stored in BTU/hr.
+    void printLoadColumns(std::ostream& os, units::BtuHr q, units::System sys) {
+        if (sys == units::System::SI) {
+            os << std::setw(14) << std::fixed << std::setprecision(1) << units::btuhr_to_w(q)
+                << std::setw(12) << std::fixed << std::setprecision(3) << units::btuhr_to_kw(q);
+        }
+        else {
+            os << std::setw(14) << std::fixed << std::setprecision(1) << q
+                << std::setw(12) << std::fixed << std::setprecision(3) << units::btuhr_to_kw(q)
+                << std::setw(10) << std::fixed << std::setprecision(3) << units::btuhr_to_ton(q);
+        }
+    }
+
+    void csvLoadColumns(std::ostream& os, units::BtuHr q, units::System sys) {
+        if (sys == units::System::SI) {
+            os << std::fixed << std::setprecision(1) << units::btuhr_to_w(q) << ","
+                << std::fixed << std::setprecision(3) << units::btuhr_to_kw(q);
+        }
+        else {
+            os << std::fixed << std::setprecision(1) << q << ","
+                << std::fixed << std::setprecision(3) << units::btuhr_to_kw(q) << ","
+                << std::fixed << std::setprecision(3) << units::btuhr_to_ton(q);
+        }
+    }
+
+    void printTableHeader(const std::string& title, units::System sys) {
+        const bool si = (sys == units::System::SI);
+        std::cout << "\n------------------ " << title << " ------------------\n";
+        std::cout << std::left
+            << std::setw(4) << "#"
+            << std::setw(28) << "Name"
+            << std::setw(14) << "Method"
+            << std::right;
+        if (si) std::cout << std::setw(14) << "W" << std::setw(12) << "kW";
+        else std::cout << std::setw(14) << "BTU/hr" << std::setw(12) << "kW" << std::setw(10) << "Tons";
+        std::cout << "\n";
+
+        std::cout << std::string(si ? 72 : 82, '-') << "\n";
+    }
+
+    void printTableRow(const Project& items, size_t i, units::System sys) {
+        std::cout << std::left
+            << std::setw(4) << (std::to_string(i + 1) + ")")
+            << std::setw(28) << items.name(i).substr(0, 27)
+            << std::setw(14) << calcs::methodLabel(items.methods[i])
+            << std::right;
+        printLoadColumns(std::cout, items.btu_per_hr[i], sys);
+        std::cout << "\n";
+    }
+
+    void printTableFooter(const std::string& label, units::BtuHr total, units::System sys) {
+        std::cout << std::string(sys == units::System::SI ? 72 : 82, '-') << "\n";
+        std::cout << std::right << std::setw(46) << label;
+        printLoadColumns(std::cout, total, sys);
+        std::cout << "\n";
+        std::cout << "----------------------------------------------------------\n\n";
+    }
+
+    void printItemTable(const Project& items, units::System sys) {
+        printTableHeader("PROJECT LOAD SUMMARY", sys);
+        for (size_t i = 0; i < items.size(); ++i) printTableRow(items, i, sys);
+        printTableFooter("TOTAL:", totalLoad(items), sys);
+    }
+
+    // Rows picked by a query, in the given order, keeping their project #.
+    void printSelectedRows(const Project& items, const std::vector<std::uint32_t>& rows,
+        const std::string& title, units::System sys) {
+        printTableHeader(title, sys);
+        for (std::uint32_t i : rows) printTableRow(items, i, sys);
+        double sub = numeric::sumIndexed(rows.size(),
+            [&](std::size_t k) { return items.btu_per_hr[rows[k]].value; });
+        printTableFooter("SUBTOTAL (" + std::to_string(rows.size()) + "):", units::BtuHr(sub), sys);
+    }
+
+    const char* loadsCSVHeader(units::System sys) {
+        return sys == units::System::SI ? "Index,Name,Method,W,kW\n" : "Index,Name,Method,BTU_per_hr,kW,Tons\n";
+    }
+
+    // One project CSV row after its index: "name","method",<load columns>.
+    // The load columns come from `cells`, keyed on the exact load.
+    void appendRowText(std::string& out, std::string_view name, calcs::Method m, units::BtuHr q,
+        units::System sys, memo::TextCache& cells, std::ostringstream& os) {
+        out += '"';
+        out += name;
+        out += "\",\"";
+        out += calcs::methodLabel(m);
+        out += "\",";
+        out += cells.get(memo::keyOf(q.value), [&](std::string& text) {
+            os.str(std::string());
+            csvLoadColumns(os, q, sys);
+            text = os.str();
+        });
+    }
+
+    // Project CSV body: a header, one row per load and a TOTAL row, with
+    // name(i), method(i) and load(i) giving row i. Rows from duplicate inputs
+    // (identical floors, window types) carry bit-identical loads, so with
+    // `memoize` the load cells are formatted once per distinct load and
+    // copied from a memo::TextCache afterwards.
+    template <class Name, class MethodOf, class Load>
+    memo::Stats writeLoadsCSV(std::ostream& out, std::size_t n, Name name, MethodOf method, Load load,
+        units::BtuHr total, units::System sys, bool memoize) {
+        out << loadsCSVHeader(sys);
+        memo::TextCache cells(memoize ? std::min<std::size_t>(n, std::size_t(1) << 16) : 0);
+        std::ostringstream os;
+        std::string row;
+        for (size_t i = 0; i < n; ++i) {
+            row.clear();
+            appendRowText(row, name(i), method(i), load(i), sys, cells, os);
+            out << (i + 1) << "," << row << "\n";
+        }
+
+        out << ",\"TOTAL\",\"\",";
+        csvLoadColumns(out, total, sys);
+        out << "\n";
+        return cells.stats();
+    }
+
+    void exportCSV(const Project& items, const std::string& path, units::System sys, bool memoize = true) {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "  ***Error*** Could not write file: " << path << "\n";
+            return;
+        }
+
+        memo::Stats st = writeLoadsCSV(out, items.size(),
+            [&items](std::size_t i) { return items.name(i); },
+            [&items](std::size_t i) { return items.methods[i]; },
+            [&items](std::size_t i) { return items.btu_per_hr[i]; },
+            totalLoad(items), sys, memoize);
+
+        std::cout << "  Saved: " << path << "\n";
+        if (st.hits)
+            std::cout << "  Reused formatting for " << st.hits << " of " << items.size() << " row(s) ("
+                << std::fixed << std::setprecision(1) << st.hitRate() * 100.0 << "% hit rate).\n";
+    }
+
+    void printGroupSummary(const std::vector<query::GroupRow>& rows, const std::string& title, units::System sys) {
+        const bool si = (sys == units::System::SI);
+        auto load = [si](units::BtuHr q) { return si ? units::btuhr_to_w(q).value : q.value; };
+
+        std::cout << "\n------------------ " << title << " ------------------\n";
+        std::cout << std::left << std::setw(28) << "Group"
+            << std::right
+            << std::setw(10) << "Count"
+            << std::setw(16) << (si ? "Total W" : "Total BTU/hr")
+            << std::setw(14) << "Min"
+            << std::setw(14) << "Max"
+            << std::setw(9) << "Share"
+            << "\n";
+        std::cout << std::string(91, '-') << "\n";
+
+        for (const query::GroupRow& g : rows) {
+            std::cout << std::left << std::setw(28) << g.key.substr(0, 27)
+                << std::right
+                << std::setw(10) << g.count
+                << std::setw(16) << std::fixed << std::setprecision(1) << load(g.total)
+                << std::setw(14) << load(g.min)
+                << std::setw(14) << load(g.max)
+                << std::setw(8) << std::setprecision(1) << g.share * 100.0 << "%"
+                << "\n";
+        }
+        std::cout << "----------------------------------------------------------\n\n";
+    }
+
+} // namespace ui
+
+namespace io {
+
+    // Splits one CSV line, honoring double-quoted fields ("" is a literal quote).
+    // Reuses the strings already in `fields`, so a caller splitting many
+    // lines into the same vector stops allocating after the first few.
+    void splitCSV(const std::string& line, std::vector<std::string>& fields) {
+        std::size_t n = 0;
+        auto next = [&fields, &n]() -> std::string& {
+            if (n == fields.size()) fields.emplace_back();
+            fields[n].clear();
+            return fields[n++];
+        };
+        std::string* cur = &next();
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); ++i) {
+            char ch = line[i];
+            if (quoted) {
+                if (ch == '"' && i + 1 < line.size() && line[i + 1] == '"') { *cur += '"'; ++i; }
+                else if (ch == '"') quoted = false;
+                else *cur += ch;
+            }
+            else if (ch == '"') quoted = true;
+            else if (ch == ',') cur = &next();
+            else if (ch != '\r') *cur += ch;
+        }
+        fields.resize(n);
+    }
+
+    std::vector<std::string> splitCSV(const std::string& line) {
+        std::vector<std::string> fields;
+        splitCSV(line, fields);
+        return fields;
+    }
+
+    bool parseNumber(const std::string& s, double& out) {
+        if (s.empty()) return false;
+        char* end = nullptr;
+        out = std::strtod(s.c_str(), &end);
+        while (*end == ' ') ++end;
+        return *end == '\0';
+    }
+
+    // Project input file, one item per row:
+    //   Method,Name,A,B,C[,Zone,Tag]
+    // with A/B/C as in calcs::evaluate_batch (C may be blank for the two-input
+    // methods). For Cond(UA), A may be "@<assembly name>" to take U from the
+    // project's assembly library. A line "# units=SI" switches the inputs to
+    // L/s, m³/h, W/m²·K, m², m³, K and W/m² (W per unit for Internal).
+    //
+    // An input starting with '=' is a formula (see expr), e.g. "=area*height",
+    // over variables set by lines such as "# let area = 40*30". Lets are
+    // applied in file order once the whole file is read, so every formula
+    // sees a name's last definition. Other '#' lines are comments.
+    //
+    // Rows are parsed into columns first; SI columns are then converted in
+    // whole-column passes and evaluated in one batch, instead of converting
+    // and computing value by value.
+    //
+    // Names, zones and tags are views into the batch's own arena, and the
+    // per-row field strings are reused, so parsing a row allocates nothing
+    // once the buffers have grown; it all goes when the batch does.
+    struct ImportColumns {
+        Arena text;
+        std::vector<std::string_view> names;
+        std::vector<calcs::Method> methods;
+        std::vector<double> a, b, c;
+        std::vector<std::uint32_t> assemblies;
+        std::vector<std::string_view> zones, tags;
+        std::vector<std::string> fields; // splitCSV scratch
+        std::string label;               // scratch for default names
+
+        // Formula inputs are left at 0 by the parse and filled in by
+        // resolveFormulas. Each distinct text is checked once.
+        struct FormulaCell {
+            std::uint32_t row;
+            std::uint32_t text; // id in formulaTexts
+            std::uint8_t input; // 0, 1, 2 for a, b, c
+        };
+        struct Let {
+            std::string_view name; // empty if the line is malformed
+            std::string_view text;
+        };
+        Dictionary formulaTexts;
+        std::vector<std::uint8_t> formulaOk; // per text
+        expr::Variables formulaNames;         // names seen by the checks
+        std::vector<FormulaCell> formulas;
+        std::vector<Let> lets;
+
+        size_t size() const { return methods.size(); }
+    };
+
+    // Per-method SI -> imperial factors for columns A, B, C.
+    // Internal gains take W per unit in SI files; Latent dW is kg/kg either way.
+    constexpr double SI_FACTOR_A[calcs::METHOD_COUNT] = {
+        units::CFM_PER_LPS, units::GPM_PER_M3H, units::U_PER_U_SI, 1.0, 1.0, 1.0, units::CFM_PER_LPS };
+    constexpr double SI_FACTOR_B[calcs::METHOD_COUNT] = {
+        units::F_PER_K, units::F_PER_K, units::FT2_PER_M2, units::FT3_PER_M3, units::FT2_PER_M2, units::BTU_PER_HR_PER_W, 1.0 };
+    constexpr double SI_FACTOR_C[calcs::METHOD_COUNT] = {
+        1.0, 1.0, units::F_PER_K, units::F_PER_K, units::BTU_PER_HR_PER_W / units::FT2_PER_M2, 1.0, 1.0 };
+
+    void convertSIColumns(ImportColumns& cols) {
+        const std::uint8_t* key = reinterpret_cast<const std::uint8_t*>(cols.methods.data());
+        units::scale_column_by_key(cols.a.data(), key, SI_FACTOR_A, cols.size());
+        units::scale_column_by_key(cols.b.data(), key, SI_FACTOR_B, cols.size());
+        units::scale_column_by_key(cols.c.data(), key, SI_FACTOR_C, cols.size());
+    }
+
+    // Applies a "# units=SI" / "# units=Imperial" comment line to `sys`.
+    // Returns true if the line named a unit system.
+    bool unitsDirective(const std::string& line, units::System& sys) {
+        if (line.find("units=SI") != std::string::npos) sys = units::System::SI;
+        else if (line.find("units=Imperial") != std::string::npos) sys = units::System::Imperial;
+        else return false;
+        return true;
+    }
+
+    // Records a "# let name = formula" line in `cols`. Returns false for
+    // other lines.
+    bool letDirective(const std::string& line, ImportColumns& cols) {
+        std::string_view s(line);
+        std::size_t at = s.find_first_not_of(' ', 1);
+        if (at == std::string_view::npos || s.compare(at, 4, "let ") != 0) return false;
+
+        ImportColumns::Let let;
+        const std::size_t eq = s.find('=', at + 4);
+        std::string_view name = s.substr(at + 4, eq == std::string_view::npos ? 0 : eq - at - 4);
+        while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+        bool valid = !name.empty() && expr::nameStart(name[0])
+            && std::all_of(name.begin(), name.end(), expr::nameChar);
+        if (valid) {
+            let.name = cols.text.store(name);
+            let.text = cols.text.store(s.substr(eq + 1));
+        }
+        cols.lets.push_back(let);
+        return true;
+    }
+
+    // Parses one non-comment row into `cols`; a malformed row is counted in
+    // `skipped` instead.
+    void readProjectRow(const std::string& line, const envelope::Library& lib, ImportColumns& cols, size_t& skipped) {
+        std::vector<std::string>& f = cols.fields;
+        splitCSV(line, f);
+        calcs::Method m;
+        if (f.size() < 4 || !calcs::parseMethod(f[0], m)) {
+            if (f[0] != "Method") ++skipped; // header row is not an error
+            return;
+        }
+
+        const bool threeInputs = (m == calcs::Method::Conduction || m == calcs::Method::AchAir
+            || m == calcs::Method::Solar || m == calcs::Method::Internal);
+        double a = 0.0, b = 0.0, c = 1.0;
+        std::uint32_t assembly = 0;
+        ImportColumns::FormulaCell cells[3];
+        int formulas = 0;
+        auto input = [&](std::uint8_t k, double& v) {
+            const std::string& field = f[2 + k];
+            if (field.empty() || field[0] != '=') return parseNumber(field, v);
+            const std::size_t known = cols.formulaTexts.size();
+            const std::uint32_t id = cols.formulaTexts.intern(std::string_view(field).substr(1));
+            if (cols.formulaTexts.size() != known) {
+                expr::Program check;
+                cols.formulaOk.push_back(expr::compile(cols.formulaTexts[id], cols.formulaNames, check));
+            }
+            v = 0.0;
+            cells[formulas++] = ImportColumns::FormulaCell{ static_cast<std::uint32_t>(cols.size()), id, k };
+            return cols.formulaOk[id] != 0;
+        };
+        const bool byAssembly = (m == calcs::Method::Conduction && !f[2].empty() && f[2][0] == '@');
+        if ((byAssembly ? !lib.find(f[2].substr(1), assembly) : !input(0, a))
+            || !input(1, b)
+            || (threeInputs && (f.size() < 5 || !input(2, c)))) {
+            ++skipped;
+            return;
+        }
+        cols.formulas.insert(cols.formulas.end(), cells, cells + formulas);
+
+        if (f[1].empty()) {
+            cols.label.assign(calcs::methodLabel(m));
+            cols.label += " Load";
+        }
+        cols.names.push_back(cols.text.store(f[1].empty() ? cols.label : f[1]));
+        cols.methods.push_back(m);
+        cols.a.push_back(a);
+        cols.b.push_back(b);
+        cols.c.push_back(c);
+        cols.assemblies.push_back(assembly);
+        cols.zones.push_back(f.size() > 5 ? cols.text.store(f[5]) : std::string_view());
+        cols.tags.push_back(f.size() > 6 ? cols.text.store(f[6]) : std::string_view());
+    }
+
+    // Malformed rows are skipped and counted in `skipped`.
+    void readProjectCSV(std::istream& in, const envelope::Library& lib, ImportColumns& cols,
+        units::System& sys, size_t& skipped) {
+        std::string line;
+        skipped = 0;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                if (!unitsDirective(line, sys)) letDirective(line, cols);
+                continue;
+            }
+            readProjectRow(line, lib, cols, skipped);
+        }
+    }
+
+    // Applies the file's lets to `vars` in order; each sees the ones before
+    // it. Returns the number that were malformed.
+    size_t applyLets(const ImportColumns& cols, expr::Variables& vars) {
+        size_t bad = 0;
+        expr::Program p;
+        for (const ImportColumns::Let& let : cols.lets) {
+            if (let.name.empty() || !expr::compile(let.text, vars, p)) {
+                ++bad;
+                continue;
+            }
+            const double v = expr::run(p, vars.values.data());
+            vars.set(vars.id(let.name), v);
+        }
+        return bad;
+    }
+
+    // Fills in the formula inputs, after convertSIColumns: each distinct
+    // formula and column scale is compiled into `table` and run once, then
+    // gathered into its rows already in imperial units. With `links`, each
+    // row's formula ids are kept too, so it can be re-evaluated later.
+    void resolveFormulas(ImportColumns& cols, units::System sys, expr::Variables& vars, expr::Table& table,
+        std::vector<expr::Inputs>* links = nullptr) {
+        if (cols.formulas.empty()) return;
+        if (links) links->assign(cols.size(), expr::Inputs());
+
+        // Last id per (text, input), reused while the scale matches.
+        struct Seen {
+            std::uint32_t id = 0;
+            double scale = 0.0;
+        };
+        std::vector<Seen> seen(cols.formulaTexts.size() * 3);
+        const double* factor[3] = { SI_FACTOR_A, SI_FACTOR_B, SI_FACTOR_C };
+        std::vector<std::uint32_t> ids(cols.formulas.size());
+        for (std::size_t j = 0; j < cols.formulas.size(); ++j) {
+            const ImportColumns::FormulaCell& cell = cols.formulas[j];
+            const double scale = sys == units::System::SI
+                ? factor[cell.input][static_cast<int>(cols.methods[cell.row])] : 1.0;
+            Seen& s = seen[cell.text * 3 + cell.input];
+            if (s.id == 0 || s.scale != scale)
+                s = Seen{ table.intern(cols.formulaTexts[cell.text], scale, vars), scale };
+            ids[j] = s.id;
+        }
+
+        table.evaluate(vars);
+        double* in[3] = { cols.a.data(), cols.b.data(), cols.c.data() };
+        for (std::size_t j = 0; j < cols.formulas.size(); ++j) {
+            const ImportColumns::FormulaCell& cell = cols.formulas[j];
+            in[cell.input][cell.row] = table.values[ids[j]];
+            if (links) (*links)[cell.row].id[cell.input] = ids[j];
+        }
+    }
+
+    // Appends the evaluated rows of a project file to `items`. Returns the
+    // number of items added, or -1 if the file could not be read.
+    long importProjectCSV(const std::string& path, const Settings& cfg, Project& items) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cout << "  ***Error*** Could not read file: " << path << "\n";
+            return -1;
+        }
+
+        ImportColumns cols;
+        units::System sys = cfg.system;
+        size_t skipped = 0;
+        readProjectCSV(in, items.library, cols, sys, skipped);
+        if (sys == units::System::SI) convertSIColumns(cols);
+        const calcs::BatchFactors factors = calcs::batchFactors(cfg.airFactor, cfg.fluidFactor);
+
+        // The file's lets become project variables, so earlier formula rows
+        // follow them too.
+        if (!cols.lets.empty()) {
+            skipped += applyLets(cols, items.vars);
+            items.reevaluateFormulas(factors);
+        }
+        std::vector<expr::Inputs> links;
+        resolveFormulas(cols, sys, items.vars, items.formulas, &links);
+        envelope::gatherU(items.library, cols.assemblies.data(), cols.a.data(), cols.size());
+
+        std::vector<double> q(cols.size());
+        calcs::evaluate_batch(cols.methods.data(), cols.a.data(), cols.b.data(), cols.c.data(), q.data(), cols.size(),
+            factors);
+
+        const std::size_t first = items.size();
+        items.reserve(items.size() + cols.size());
+        items.byLoad.stale = true; // one rebuild later beats n sorted inserts
+        for (size_t i = 0; i < cols.size(); ++i)
+            items.emplace(cols.names[i], cols.methods[i], units::BtuHr(q[i]), cols.zones[i], cols.tags[i],
+                cols.a[i], cols.b[i], cols.c[i], cols.assemblies[i]);
+        std::copy(links.begin(), links.end(), items.derived.begin() + first);
+
+        if (skipped) std::cout << "  [Warning] Skipped " << skipped << " malformed row(s).\n";
+        if (!cols.formulas.empty()) {
+            std::string undefined = expr::undefinedNames(items.vars);
+            if (!undefined.empty()) std::cout << "  [Warning] Undefined variable(s) taken as 0: " << undefined << "\n";
+        }
+        std::cout << "  Imported " << cols.size() << " item(s) (" << units::systemName(sys) << " inputs).\n";
+        return static_cast<long>(cols.size());
+    }
+
+    // Assembly library file:
+    //   Assembly,<name>,<framing fraction>[,<inside film R>,<outside film R>]
+    //   Layer,<name>,<R>[,<R along framing>]
+    // Layers belong to the Assembly row above them. R-values are
+    // hr·ft²·F/BTU, or m²·K/W after a "# units=SI" line. An assembly whose
+    // name is already in the library replaces it. Returns the number of
+    // assemblies defined, or -1 if the file could not be read.
+    long importAssemblies(const std::string& path, envelope::Library& lib) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cout << "  ***Error*** Could not read file: " << path << "\n";
+            return -1;
+        }
+
+        constexpr double R_PER_R_SI = 1.0 / units::U_PER_U_SI;
+        double rScale = 1.0;
+        std::vector<envelope::Assembly> parsed;
+        size_t skipped = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                if (line.find("units=SI") != std::string::npos) rScale = R_PER_R_SI;
+                else if (line.find("units=Imperial") != std::string::npos) rScale = 1.0;
+                continue;
+            }
+
+            std::vector<std::string> f = splitCSV(line);
+            double x = 0.0, y = 0.0;
+            if (f[0] == "Assembly" && f.size() >= 3 && !f[1].empty() && parseNumber(f[2], x) && x >= 0.0 && x <= 1.0) {
+                envelope::Assembly a;
+                a.name = f[1];
+                a.framingFraction = x;
+                if (f.size() >= 5 && parseNumber(f[3], x) && parseNumber(f[4], y)) {
+                    a.insideFilm = units::RValue(x * rScale);
+                    a.outsideFilm = units::RValue(y * rScale);
+                }
+                parsed.push_back(std::move(a));
+            }
+            else if (f[0] == "Layer" && f.size() >= 3 && !parsed.empty() && parseNumber(f[2], x)) {
+                if (f.size() < 4 || !parseNumber(f[3], y)) y = x;
+                parsed.back().layers.push_back(envelope::Layer{ f[1], units::RValue(x * rScale), units::RValue(y * rScale) });
+            }
+            else {
+                ++skipped;
+            }
+        }
+
+        for (envelope::Assembly& a : parsed) lib.define(std::move(a));
+        if (skipped) std::cout << "  [Warning] Skipped " << skipped << " malformed row(s).\n";
+        std::cout << "  Loaded " << parsed.size() << " assembly(ies).\n";
+        return static_cast<long>(parsed.size());
+    }
+
+    // Equipment catalog, one curve point per row:
+    //   Model,EnteringTemp,Capacity
+    // in F and BTU/hr, or C and W after "# units=SI". Points of a model may
+    // come in any order. Replaces the catalog; returns the model count or -1.
+    long importCatalog(const std::string& path, sizing::Catalog& cat) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cout << "  ***Error*** Could not read file: " << path << "\n";
+            return -1;
+        }
+
+        sizing::Catalog fresh;
+        std::vector<std::uint32_t> model;
+        std::vector<double> t, q;
+        bool si = false;
+        size_t skipped = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                if (line.find("units=SI") != std::string::npos) si = true;
+                else if (line.find("units=Imperial") != std::string::npos) si = false;
+                continue;
+            }
+
+            std::vector<std::string> f = splitCSV(line);
+            double x = 0.0, y = 0.0;
+            if (f.size() < 3 || f[0].empty() || !parseNumber(f[1], x) || !parseNumber(f[2], y) || y < 0.0) {
+                if (f[0] != "Model") ++skipped; // header row is not an error
+                continue;
+            }
+            model.push_back(fresh.models.intern(f[0]));
+            t.push_back(si ? x * units::F_PER_K + 32.0 : x);
+            q.push_back(si ? y * units::BTU_PER_HR_PER_W : y);
+        }
+
+        fresh.assign(model, t, q);
+        cat = std::move(fresh);
+        if (skipped) std::cout << "  [Warning] Skipped " << skipped << " malformed row(s).\n";
+        std::cout << "  Loaded " << cat.size() << " model(s), " << q.size() << " curve point(s).\n";
+        return static_cast<long>(cat.size());
+    }
+
+    // Envelope surface list, one polygon per row:
+    //   Surface,<name>,<assembly name or U>,<orientation>,<dT>,x1,y1,z1,x2,y2,z2,...
+    // Vertices are ft (m after "# units=SI", with dT in K and a numeric U in
+    // W/m²·K then; assembly names are unaffected). A blank
+    // orientation is derived from the polygon normal. Areas for the whole
+    // file are computed in one pass, U is gathered from the assembly library
+    // and all surfaces go through one batched conduction evaluation; each
+    // becomes a Cond(UA) item tagged with its orientation. Returns the number
+    // of surfaces added, or -1 if the file could not be read.
+    long importSurfaces(const std::string& path, Project& items) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cout << "  ***Error*** Could not read file: " << path << "\n";
+            return -1;
+        }
+
+        geometry::PolygonSet poly;
+        std::vector<std::string> names, orientations;
+        std::vector<std::uint32_t> assemblies;
+        std::vector<units::UValue> u;
+        std::vector<units::DeltaF> dT;
+        double lengthScale = 1.0, dTScale = 1.0, uScale = 1.0;
+        size_t skipped = 0;
+
+        std::string line;
+        std::vector<std::string> f; // refilled per row
+        std::vector<double> v;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                if (line.find("units=SI") != std::string::npos) {
+                    lengthScale = units::FT_PER_M;
+                    dTScale = units::F_PER_K;
+                    uScale = units::U_PER_U_SI;
+                }
+                else if (line.find("units=Imperial") != std::string::npos) {
+                    lengthScale = 1.0;
+                    dTScale = 1.0;
+                    uScale = 1.0;
+                }
+                continue;
+            }
+
+            splitCSV(line, f);
+            std::uint32_t assembly = 0;
+            double directU = 0.0, t = 0.0;
+            if (f[0] != "Surface" || f.size() < 14 || (f.size() - 5) % 3 != 0
+                || (!items.library.find(f[2], assembly) && !parseNumber(f[2], directU))
+                || !parseNumber(f[4], t)) {
+                ++skipped;
+                continue;
+            }
+
+            v.resize(f.size() - 5);
+            bool ok = true;
+            for (size_t k = 0; k < v.size() && ok; ++k) ok = parseNumber(f[5 + k], v[k]);
+            if (!ok) {
+                ++skipped;
+                continue;
+            }
+            for (size_t k = 0; k < v.size(); k += 3)
+                poly.addVertex(v[k] * lengthScale, v[k + 1] * lengthScale, v[k + 2] * lengthScale);
+            poly.closePolygon();
+
+            names.push_back(f[1].empty() ? std::string("Surface") : f[1]);
+            orientations.push_back(f[3]);
+            assemblies.push_back(assembly);
+            u.push_back(units::UValue(directU * uScale)); // library U-values are already imperial
+            dT.push_back(units::DeltaF(t * dTScale));
+        }
+
+        const size_t n = poly.size();
+        std::vector<units::SqFt> area(n);
+        std::vector<double> nx(n), ny(n), nz(n);
+        geometry::areasAndNormals(poly, area.data(), nx.data(), ny.data(), nz.data());
+
+        envelope::gatherU(items.library, assemblies.data(), u.data(), n);
+
+        std::vector<units::BtuHr> q(n);
+        calcs::conduction_btuhr(u.data(), area.data(), dT.data(), q.data(), n);
+
+        items.reserve(items.size() + n);
+        items.byLoad.stale = true;
+        for (size_t k = 0; k < n; ++k) {
+            std::string_view tag = orientations[k];
+            if (tag.empty()) tag = geometry::orientationOf(nx[k], ny[k], nz[k]);
+            items.emplace(names[k], calcs::Method::Conduction, q[k], items.activeZone, tag,
+                u[k].value, area[k].value, dT[k].value, assemblies[k]);
+        }
+
+        if (skipped) std::cout << "  [Warning] Skipped " << skipped << " malformed row(s).\n";
+        std::cout << "  Imported " << n << " surface(s).\n";
+        return static_cast<long>(n);
+    }
+
+    // Hourly weather file, one reading per line with the dry-bulb in the last
+    // field, so a bare column and "Date,Hour,Temp" rows both work. A leading
+    // non-numeric row is a header; "# units=SI" switches readings to C. The
+    // file is streamed once into `dh`. Returns the hours read, or -1.
+    long importWeather(const std::string& path, energy::DegreeHours& dh) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cout << "  ***Error*** Could not read file: " << path << "\n";
+            return -1;
+        }
+
+        bool celsius = false;
+        bool first = true;
+        size_t skipped = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                if (line.find("units=SI") != std::string::npos) celsius = true;
+                else if (line.find("units=Imperial") != std::string::npos) celsius = false;
+                continue;
+            }
+
+            std::string::size_type comma = line.rfind(',');
+            double t;
+            if (!parseNumber(comma == std::string::npos ? line : line.substr(comma + 1), t) || !std::isfinite(t)) {
+                if (!first) ++skipped; // header row is not an error
+                first = false;
+                continue;
+            }
+            first = false;
+            dh.add(units::DegF(celsius ? t * units::F_PER_K + 32.0 : t));
+        }
+        dh.finish();
+
+        if (skipped) std::cout << "  [Warning] Skipped " << skipped << " malformed row(s).\n";
+        std::cout << "  Read " << dh.hours << " hour(s) of weather.\n";
+        return static_cast<long>(dh.hours);
+    }
+
+} // namespace io
+
+namespace portfolio {
+
+    // Project files are cut at line breaks into pieces of about this size, so
+    // a 500k-row building becomes a few dozen tasks other workers can steal
+    // instead of one that holds up the whole run.
+    constexpr std::size_t PIECE_BYTES = std::size_t(1) << 20;
+
+    // Bumped whenever evaluation or the CSV layout changes, which retires
+    // every cache entry written before.
+    constexpr std::uint64_t CACHE_FORMAT = 2;
+
+    struct Options {
+        std::string outDir;   // per-project load CSVs go here if set
+        std::string cacheDir; // results and CSVs of earlier runs, if set
+        bool memoize = true;
+    };
+
+    struct Result {
+        std::string path;
+        std::size_t items = 0;
+        std::size_t skipped = 0;
+        units::BtuHr total;
+        bool ok = false;
+        bool cached = false; // taken from the cache, nothing parsed
+    };
+
+    // What every project in a run shares. `seed` folds in everything besides
+    // the file's own bytes that its results depend on.
+    struct Context {
+        const envelope::Library& lib;
+        const Settings& cfg;
+        const Options& opt;
+        std::uint64_t seed = 0;
+    };
+
+    struct Piece {
+        io::ImportColumns cols;
+        size_t skipped = 0;
+        bool setsUnits = false;  // a units directive appeared in this piece
+        units::System sys = units::System::Imperial; // the last one, if so
+        std::size_t first = 0;   // project row of this piece's first row
+        std::string csv;         // this piece's rows of the load CSV
+    };
+
+    // One project in flight, in two rounds of piece tasks. Whichever piece
+    // finishes parsing last settles what spans the file (units, lets,
+    // formulas) and starts the second round; there each piece evaluates and
+    // formats its own rows, and the last to finish totals the project and
+    // writes its CSV. The text and columns go away with the last task
+    // holding the job.
+    struct Job {
+        std::string text;
+        std::uint64_t key = 0;
+        std::vector<std::size_t> bounds; // piece k is text[bounds[k], bounds[k + 1])
+        std::vector<Piece> pieces;
+        std::vector<double> q;           // loads, in project row order
+        bool writeCSV = false;
+        std::atomic<std::size_t> remaining{ 0 };
+        std::atomic<bool> failed{ false };
+    };
+
+    // Regular *.csv files directly in `dir`, sorted by path.
+    std::vector<std::string> listProjects(const std::string& dir) {
+        std::vector<std::string> paths;
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && it->path().extension() == ".csv") paths.push_back(it->path().string());
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    // Unit system, site factors and the assembly library's U-values. The
+    // library is hashed in name order, so equal libraries give equal keys
+    // however their maps were built.
+    std::uint64_t settingsSeed(const envelope::Library& lib, const Settings& cfg) {
+        std::vector<std::pair<std::string_view, std::uint32_t>> entries(lib.ids.begin(), lib.ids.end());
+        std::sort(entries.begin(), entries.end());
+        std::ostringstream os;
+        os << std::hexfloat << CACHE_FORMAT << ';' << static_cast<int>(cfg.system) << ';'
+            << cfg.airFactor.value << ';' << cfg.fluidFactor.value;
+        for (const auto& entry : entries) os << ';' << entry.first << '=' << lib.u[entry.second].value;
+        const std::string s = os.str();
+        return memo::hashBytes(s.data(), s.size());
+    }
+
+    std::string hexKey(std::uint64_t key) {
+        std::ostringstream os;
+        os << std::hex << std::setw(16) << std::setfill('0') << key;
+        return os.str();
+    }
+
+    std::string outputPath(const Options& opt, const Result& r) {
+        return (std::filesystem::path(opt.outDir) / (std::filesystem::path(r.path).stem().string() + "-loads.csv")).string();
+    }
+
+    // A cache entry is <key>.res, the result with the total as an exact
+    // hexfloat, plus <key>.csv, the project's load CSV. The input size is
+    // stored too and checked, as a guard against a hash collision.
+    bool readCached(const Context& ctx, std::uint64_t key, std::size_t bytes, Result& r) {
+        std::filesystem::path base = std::filesystem::path(ctx.opt.cacheDir) / hexKey(key);
+        std::ifstream in(base.string() + ".res");
+        std::string tag, total;
+        std::size_t size = 0, items = 0, skipped = 0;
+        if (!(in >> tag >> size >> items >> skipped >> total) || tag != "heatloads-result" || size != bytes) return false;
+        double t = std::strtod(total.c_str(), nullptr);
+
+        std::error_code ec;
+        if (!ctx.opt.outDir.empty()) {
+            std::filesystem::copy_file(base.string() + ".csv", outputPath(ctx.opt, r),
+                std::filesystem::copy_options::overwrite_existing, ec);
+            if (ec) return false;
+        }
+        r.items = items;
+        r.skipped = skipped;
+        r.total = units::BtuHr(t);
+        r.ok = r.cached = true;
+        return true;
+    }
+
+    // Scratch name next to `target` for this thread. Two workers writing the
+    // same file (byte-identical projects share a cache key) never share one.
+    std::string tempPath(const std::string& target) {
+        return target + ".tmp" + hexKey(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    }
+
+    // Cache files are written under a temporary name and renamed into place,
+    // so a run that stops midway never leaves a partial entry behind, and a
+    // reader never sees a .res before its .csv. `csvTmp` is the finished CSV
+    // under its temporary name; it is moved into the entry.
+    void writeCached(const Context& ctx, std::uint64_t key, std::size_t bytes, const Result& r, const std::string& csvTmp) {
+        const std::string base = (std::filesystem::path(ctx.opt.cacheDir) / hexKey(key)).string();
+        std::error_code ec;
+        std::filesystem::rename(csvTmp, base + ".csv", ec);
+        if (ec) {
+            std::filesystem::remove(csvTmp, ec);
+            return;
+        }
+        const std::string tmp = tempPath(base + ".res");
+        {
+            std::ofstream out(tmp);
+            out << "heatloads-result " << bytes << " " << r.items << " " << r.skipped << " "
+                << std::hexfloat << r.total.value << "\n";
+            if (!out) {
+                out.close();
+                std::filesystem::remove(tmp, ec);
+                return;
+            }
+        }
+        std::filesystem::rename(tmp, base + ".res", ec);
+    }
+
+    void parsePiece(Job& job, std::size_t k, const envelope::Library& lib) {
+        Piece& piece = job.pieces[k];
+        const std::string& text = job.text;
+        std::string line;
+        for (std::size_t pos = job.bounds[k], end = job.bounds[k + 1]; pos < end;) {
+            std::size_t nl = text.find('\n', pos);
+            if (nl == std::string::npos || nl > end) nl = end;
+            line.assign(text, pos, nl - pos);
+            pos = nl + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                if (io::unitsDirective(line, piece.sys)) piece.setsUnits = true;
+                else io::letDirective(line, piece.cols);
+                continue;
+            }
+            io::readProjectRow(line, lib, piece.cols, piece.skipped);
+        }
+    }
+
+    // First half of io::importProjectCSV for the whole file, once every
+    // piece is parsed: the last units directive applies to every row and each
+    // formula sees every let. Numbers the rows and sizes the load column.
+    void settle(Job& job, Result& r, const Context& ctx) {
+        units::System sys = ctx.cfg.system;
+        std::size_t n = 0;
+        expr::Variables vars;
+        expr::Table formulas;
+        for (Piece& p : job.pieces) {
+            if (p.setsUnits) sys = p.sys;
+            p.first = n;
+            n += p.cols.size();
+            r.skipped += p.skipped + io::applyLets(p.cols, vars);
+        }
+        for (Piece& p : job.pieces) {
+            if (sys == units::System::SI) io::convertSIColumns(p.cols);
+            io::resolveFormulas(p.cols, sys, vars, formulas);
+        }
+        job.q.resize(n);
+        job.writeCSV = !ctx.opt.outDir.empty() || !ctx.opt.cacheDir.empty();
+        r.items = n;
+    }
+
+    // Evaluates piece k's rows into job.q and, if a CSV is wanted, formats
+    // them with their project row numbers into the piece's own buffer.
+    void evaluatePiece(Job& job, std::size_t k, const Context& ctx) {
+        Piece& p = job.pieces[k];
+        io::ImportColumns& cols = p.cols;
+        const std::size_t n = cols.size();
+        double* q = job.q.data() + p.first;
+        envelope::gatherU(ctx.lib, cols.assemblies.data(), cols.a.data(), n);
+        calcs::evaluate_batch(cols.methods.data(), cols.a.data(), cols.b.data(), cols.c.data(), q, n,
+            calcs::batchFactors(ctx.cfg.airFactor, ctx.cfg.fluidFactor));
+        if (!job.writeCSV) return;
+
+        // One memo per worker, kept across pieces and projects: a piece is
+        // too short to warm a cache of its own. Cached text depends on the
+        // load and the unit system only.
+        struct Memo {
+            memo::TextCache cells{ std::size_t(1) << 16 };
+            units::System sys = units::System::Imperial;
+        };
+        thread_local Memo shared;
+        memo::TextCache none(0);
+        if (shared.sys != ctx.cfg.system) shared = Memo{ memo::TextCache(std::size_t(1) << 16), ctx.cfg.system };
+        memo::TextCache& cells = ctx.opt.memoize ? shared.cells : none;
+        std::ostringstream os;
+        char index[24];
+        for (std::size_t i = 0; i < n; ++i) {
+            auto end = std::to_chars(index, index + sizeof index, p.first + i + 1).ptr;
+            p.csv.append(index, end);
+            p.csv += ',';
+            ui::appendRowText(p.csv, cols.names[i], cols.methods[i], units::BtuHr(q[i]), ctx.cfg.system, cells, os);
+            p.csv += '\n';
+        }
+    }
+
+    // Same total and CSV as totalLoad and ui::exportCSV after an import: one
+    // ordered sum over every load, and the pieces' rows joined in order.
+    void finish(Job& job, Result& r, const Context& ctx) {
+        const std::vector<double>& q = job.q;
+        r.total = units::BtuHr(numeric::sumIndexed(q.size(), [&q](std::size_t i) { return q[i]; }, false));
+
+        const Options& opt = ctx.opt;
+        if (job.writeCSV) {
+            // Written under a temporary name, then copied to the output
+            // directory and moved into the cache, or just renamed into place.
+            const std::string tmp = tempPath(opt.cacheDir.empty() ? outputPath(opt, r)
+                : (std::filesystem::path(opt.cacheDir) / (hexKey(job.key) + ".csv")).string());
+            std::ofstream out(tmp);
+            out << ui::loadsCSVHeader(ctx.cfg.system);
+            for (Piece& p : job.pieces) {
+                out.write(p.csv.data(), static_cast<std::streamsize>(p.csv.size()));
+                std::string().swap(p.csv);
+            }
+            out << ",\"TOTAL\",\"\",";
+            ui::csvLoadColumns(out, r.total, ctx.cfg.system);
+            out << "\n";
+            out.close();
+
+            std::error_code ec;
+            if (!out) std::filesystem::remove(tmp, ec);
+            else if (opt.cacheDir.empty()) {
+                std::filesystem::rename(tmp, outputPath(opt, r), ec);
+                if (ec) std::filesystem::remove(tmp, ec);
+            }
+            else {
+                if (!opt.outDir.empty())
+                    std::filesystem::copy_file(tmp, outputPath(opt, r), std::filesystem::copy_options::overwrite_existing, ec);
+                writeCached(ctx, job.key, job.text.size(), r, tmp);
+            }
+        }
+        r.ok = true;
+    }
+
+    // Reads one project and, unless the cache already has it, parses its first
+    // piece here and spawns the rest.
+    void load(numeric::TaskPool& pool, Result& r, const Context& ctx) {
+        auto job = std::make_shared<Job>();
+        {
+            std::ifstream in(r.path, std::ios::binary);
+            if (!in) return;
+            std::ostringstream buf;
+            buf << in.rdbuf();
+            job->text = buf.str();
+        }
+
+        const std::string& text = job->text;
+        job->key = memo::hashBytes(text.data(), text.size(), ctx.seed);
+        if (!ctx.opt.cacheDir.empty() && readCached(ctx, job->key, text.size(), r)) return;
+
+        job->bounds.push_back(0);
+        while (job->bounds.back() < text.size()) {
+            std::size_t cut = job->bounds.back() + PIECE_BYTES;
+            if (cut >= text.size()) cut = text.size();
+            else {
+                cut = text.find('\n', cut);
+                cut = (cut == std::string::npos) ? text.size() : cut + 1;
+            }
+            job->bounds.push_back(cut);
+        }
+        if (job->bounds.size() == 1) job->bounds.push_back(0); // empty file: one empty piece
+
+        const std::size_t pieces = job->bounds.size() - 1;
+        job->pieces.resize(pieces);
+        job->remaining = pieces;
+        // A failed task marks the job and r stays !ok. The last task of a
+        // round runs `then` unless something failed.
+        auto step = [job](auto work, auto then) {
+            try {
+                work();
+            }
+            catch (...) {
+                job->failed = true;
+            }
+            if (job->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !job->failed) {
+                try {
+                    then();
+                }
+                catch (...) {
+                    job->failed = true;
+                }
+            }
+        };
+        auto evaluate = [job, &r, &ctx, step](std::size_t k) {
+            step([&] { evaluatePiece(*job, k, ctx); }, [&] { finish(*job, r, ctx); });
+        };
+        auto piece = [job, &pool, &r, &ctx, step, evaluate, pieces](std::size_t k) {
+            step([&] { parsePiece(*job, k, ctx.lib); }, [&] {
+                settle(*job, r, ctx);
+                job->remaining = pieces;
+                for (std::size_t j = pieces; j-- > 1;) pool.spawn([evaluate, j] { evaluate(j); });
+                evaluate(0);
+            });
+        };
+        for (std::size_t k = pieces; k-- > 1;) pool.spawn([piece, k] { piece(k); });
+        piece(0);
+    }
+
+    // Evaluates every file on one work-stealing pool with the shared assembly
+    // library and site factors. Files whose bytes and settings match a cache
+    // entry are only read and hashed; the rest are evaluated and, with a
+    // cache directory, stored for the next run. Results come back in `paths`
+    // order; a file that cannot be read is returned with ok unset.
+    std::vector<Result> evaluate(const std::vector<std::string>& paths, const envelope::Library& lib,
+        const Settings& cfg, const Options& opt) {
+        std::vector<Result> results(paths.size());
+        for (std::size_t i = 0; i < paths.size(); ++i) results[i].path = paths[i];
+
+        std::error_code ec;
+        if (!opt.outDir.empty()) std::filesystem::create_directories(opt.outDir, ec);
+        if (!opt.cacheDir.empty()) std::filesystem::create_directories(opt.cacheDir, ec);
+        const Context ctx{ lib, cfg, opt, settingsSeed(lib, cfg) };
+
+        // Largest files are queued first, so they are split and spread early
+        // rather than left for last.
+        std::vector<std::pair<std::uintmax_t, std::size_t>> bySize;
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            std::uintmax_t bytes = std::filesystem::file_size(paths[i], ec);
+            bySize.emplace_back(ec ? 0 : bytes, i);
+        }
+        std::sort(bySize.begin(), bySize.end(), [](const auto& x, const auto& y) { return x.first > y.first; });
+
+        unsigned hw = std::thread::hardware_concurrency();
+        numeric::TaskPool pool(hw ? hw : 1);
+        for (const auto& f : bySize) {
+            Result& r = results[f.second];
+            pool.spawn([&pool, &r, &ctx] {
+                try {
+                    load(pool, r, ctx);
+                }
+                catch (...) {
+                    r.ok = false;
+                }
+            });
+        }
+        pool.run();
+        return results;
+    }
+
+    // One row per project plus a portfolio total, in the unit system's
+    // load columns.
+    bool exportCSV(const std::vector<Result>& results, const std::string& path, units::System sys) {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "  ***Error*** Could not write file: " << path << "\n";
+            return false;
+        }
+
+        if (sys == units::System::SI) out << "Project,Items,Skipped,W,kW\n";
+        else out << "Project,Items,Skipped,BTU_per_hr,kW,Tons\n";
+        numeric::CompensatedSum total;
+        std::size_t items = 0;
+        for (const Result& r : results) {
+            if (!r.ok) continue;
+            out << "\"" << r.path << "\"," << r.items << "," << r.skipped << ",";
+            ui::csvLoadColumns(out, r.total, sys);
+            out << "\n";
+            total.add(r.total.value);
+            items += r.items;
+        }
+
+        out << "\"TOTAL\"," << items << ",,";
+        ui::csvLoadColumns(out, units::BtuHr(total.result()), sys);
+        out << "\n";
+
+        std::cout << "  Saved: " << path << "\n";
+        return true;
+    }
+
+} // namespace portfolio
+
+namespace watch {
+
+    enum LineKind : std::uint8_t { LINE_OTHER, LINE_ROW, LINE_UNITS, LINE_LET };
+
+    // A project file kept in step with a Project. The last version read is
+    // kept with its line offsets, so a new version is compared byte for byte
+    // from both ends: whole lines in the shared head and tail are left alone
+    // and only the lines between are parsed and evaluated, replacing the rows
+    // they held in place (or erasing and inserting when the row count
+    // changes). The export is kept as one buffer with row offsets, so an
+    // edit splices it instead of formatting every row again.
+    struct Session {
+        std::string path;
+        std::string outPath;
+        std::string text;                   // last version read
+        std::vector<std::size_t> lineStart; // per line, plus one past the last line's '\n'
+        std::vector<std::uint8_t> kinds;    // per line
+        std::string csv;                    // export header and rows, without the TOTAL row
+        std::vector<std::size_t> rowStart;  // per row, plus csv.size()
+        units::System fileSystem = units::System::Imperial; // last units directive in the file
+        expr::Variables vars;                                // from the file's lets
+        expr::Table formulas;
+        memo::TextCache cells{ std::size_t(1) << 16 };
+    };
+
+    struct Change {
+        bool ok = false;
+        bool full = false;       // a units or let line changed, so every row was redone
+        std::size_t removed = 0; // rows replaced or erased
+        std::size_t added = 0;   // rows replacing them
+    };
+
+    bool readFile(const std::string& path, std::string& text) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        text.resize(static_cast<std::size_t>(in.tellg()));
+        in.seekg(0);
+        return static_cast<bool>(in.read(&text[0], static_cast<std::streamsize>(text.size())));
+    }
+
+    // Appends the start of each line in text[begin, end) to `starts`; every
+    // '\n' ends a line and a last line without one still counts.
+    void splitLines(const std::string& text, std::size_t begin, std::size_t end, std::vector<std::size_t>& starts) {
+        for (std::size_t pos = begin; pos < end;) {
+            starts.push_back(pos);
+            const char* nl = static_cast<const char*>(std::memchr(text.data() + pos, '\n', end - pos));
+            pos = nl ? static_cast<std::size_t>(nl - text.data()) + 1 : end;
+        }
+    }
+
+    // Length of the common prefix of a and b (n bytes each), or with
+    // `fromEnd` of the common suffix, comparing 4 KiB blocks with memcmp and
+    // only the differing block byte by byte.
+    std::size_t commonLength(const char* a, const char* b, std::size_t n, bool fromEnd) {
+        constexpr std::size_t BLOCK_BYTES = 4096;
+        std::size_t done = 0;
+        while (done < n) {
+            const std::size_t len = std::min(BLOCK_BYTES, n - done);
+            const std::size_t at = fromEnd ? n - done - len : done;
+            if (std::memcmp(a + at, b + at, len) != 0) {
+                for (std::size_t k = 0; k < len; ++k) {
+                    const std::size_t i = fromEnd ? at + len - 1 - k : at + k;
+                    if (a[i] != b[i]) return done + k;
+                }
+            }
+            done += len;
+        }
+        return n;
+    }
+
+    // Where the line after the last one would start: the text size when it
+    // ends in '\n', one more when the last line is unterminated.
+    std::size_t lineSentinel(const std::string& text) {
+        return text.empty() || text.back() == '\n' ? text.size() : text.size() + 1;
+    }
+
+    // Re-reads the file and applies what changed since the last call (the
+    // whole file on the first). Rows come out exactly as io::importProjectCSV
+    // would give them, in file order.
+    Change refresh(Session& s, Project& items, const Settings& cfg) {
+        Change ch;
+        std::string text;
+        if (!readFile(s.path, text)) return ch;
+        if (text == s.text && !s.lineStart.empty()) {
+            ch.ok = true;
+            return ch;
+        }
+
+        // Line numbers: old lines [head, tailFirst) become new lines
+        // [head, head + mid.size()), the rest are shared.
+        const std::size_t oldSize = s.text.size(), newSize = text.size();
+        const std::size_t oldLines = s.kinds.size();
+        std::size_t head = 0, tailFirst = oldLines;
+        ch.full = s.lineStart.empty();
+        if (!ch.full) {
+            const std::size_t shorter = std::min(oldSize, newSize);
+            const std::size_t pre = commonLength(s.text.data(), text.data(), shorter, false);
+            const std::size_t suf = commonLength(s.text.data() + oldSize - (shorter - pre),
+                text.data() + newSize - (shorter - pre), shorter - pre, true);
+
+            // Whole lines whose '\n' lies in the shared head, then lines whose
+            // preceding '\n' lies in the shared tail.
+            head = static_cast<std::size_t>(std::upper_bound(s.lineStart.begin() + 1, s.lineStart.end(), pre) - (s.lineStart.begin() + 1));
+            tailFirst = static_cast<std::size_t>(std::lower_bound(s.lineStart.begin(), s.lineStart.end() - 1, oldSize - suf + 1) - s.lineStart.begin());
+            tailFirst = std::max(head, tailFirst);
+
+            // Units and let lines apply to the whole file, so touching one
+            // means starting over.
+            for (std::size_t k = head; k < tailFirst && !ch.full; ++k)
+                ch.full = (s.kinds[k] == LINE_UNITS || s.kinds[k] == LINE_LET);
+        }
+
+        const std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(newSize) - static_cast<std::ptrdiff_t>(oldSize);
+        std::size_t midBegin = ch.full ? 0 : s.lineStart[head];
+        std::size_t midEnd = (ch.full || tailFirst == oldLines) ? newSize : s.lineStart[tailFirst] + delta;
+        std::vector<std::size_t> mid;
+        splitLines(text, midBegin, midEnd, mid);
+
+        auto lineEnd = [&](std::size_t k) { return (k + 1 < mid.size()) ? mid[k + 1] : midEnd; };
+        units::System probe;
+        io::ImportColumns lets;
+        for (std::size_t k = 0; k < mid.size() && !ch.full; ++k) {
+            if (text[mid[k]] != '#') continue;
+            const std::string line = text.substr(mid[k], lineEnd(k) - mid[k]);
+            ch.full = io::unitsDirective(line, probe) || io::letDirective(line, lets);
+        }
+        if (ch.full && (head != 0 || tailFirst != oldLines)) {
+            head = 0;
+            tailFirst = oldLines;
+            mid.clear();
+            splitLines(text, 0, newSize, mid);
+        }
+        if (ch.full) {
+            s.fileSystem = cfg.system;
+            s.vars = expr::Variables();
+            s.formulas = expr::Table();
+        }
+
+        io::ImportColumns cols;
+        std::vector<std::uint8_t> kinds(mid.size(), LINE_OTHER);
+        size_t skipped = 0;
+        std::string line;
+        for (std::size_t k = 0; k < mid.size(); ++k) {
+            line.assign(text, mid[k], lineEnd(k) - mid[k]);
+            if (!line.empty() && line.back() == '\n') line.pop_back();
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                if (io::unitsDirective(line, s.fileSystem)) kinds[k] = LINE_UNITS;
+                else if (io::letDirective(line, cols)) kinds[k] = LINE_LET;
+                continue;
+            }
+            const std::size_t before = cols.size();
+            io::readProjectRow(line, items.library, cols, skipped);
+            if (cols.size() > before) kinds[k] = LINE_ROW;
+        }
+
+        if (s.fileSystem == units::System::SI) io::convertSIColumns(cols);
+        skipped += io::applyLets(cols, s.vars);
+        io::resolveFormulas(cols, s.fileSystem, s.vars, s.formulas);
+        envelope::gatherU(items.library, cols.assemblies.data(), cols.a.data(), cols.size());
+        std::vector<double> q(cols.size());
+        calcs::evaluate_batch(cols.methods.data(), cols.a.data(), cols.b.data(), cols.c.data(), q.data(), cols.size(),
+            calcs::batchFactors(cfg.airFactor, cfg.fluidFactor));
+
+        const std::size_t firstRow = ch.full ? 0
+            : static_cast<std::size_t>(std::count(s.kinds.begin(), s.kinds.begin() + head, LINE_ROW));
+        ch.removed = ch.full ? items.size()
+            : static_cast<std::size_t>(std::count(s.kinds.begin() + head, s.kinds.begin() + tailFirst, LINE_ROW));
+        ch.added = cols.size();
+
+        std::vector<LoadItem> fresh(cols.size());
+        std::string rows;
+        std::vector<std::size_t> rowLen(cols.size());
+        std::ostringstream os;
+        char num[24];
+        for (std::size_t i = 0; i < cols.size(); ++i) {
+            LoadItem& item = fresh[i];
+            item.name = cols.names[i];
+            item.method = cols.methods[i];
+            item.btu_per_hr = units::BtuHr(q[i]);
+            item.zone = cols.zones[i];
+            item.tag = cols.tags[i];
+            item.a = cols.a[i];
+            item.b = cols.b[i];
+            item.c = cols.c[i];
+            item.assembly = cols.assemblies[i];
+
+            const std::size_t at = rows.size();
+            rows.append(num, std::to_chars(num, num + sizeof num, firstRow + i + 1).ptr);
+            rows += ',';
+            ui::appendRowText(rows, item.name, item.method, item.btu_per_hr, cfg.system, s.cells, os);
+            rows += '\n';
+            rowLen[i] = rows.size() - at;
+        }
+
+        if (ch.full) {
+            items.clear();
+            items.insert(0, fresh);
+        }
+        else if (ch.removed == ch.added) {
+            for (std::size_t j = 0; j < fresh.size(); ++j) items.set(firstRow + j, fresh[j]);
+        }
+        else {
+            if (ch.removed) {
+                std::vector<std::uint8_t> drop(items.size(), 0);
+                std::fill(drop.begin() + firstRow, drop.begin() + firstRow + ch.removed, 1);
+                items.compact(drop);
+            }
+            items.insert(firstRow, fresh);
+        }
+
+        // Export rows [firstRow, firstRow + replaced) give way to the new
+        // ones. Later rows move by the byte difference and, when the row
+        // count changed, are renumbered.
+        const std::size_t replaced = ch.full ? 0 : ch.removed;
+        if (ch.full) {
+            s.csv = ui::loadsCSVHeader(cfg.system);
+            s.rowStart.assign(1, s.csv.size());
+        }
+        const std::size_t cut = s.rowStart[firstRow], cutEnd = s.rowStart[firstRow + replaced];
+        std::vector<std::size_t> starts(s.rowStart.begin(), s.rowStart.begin() + firstRow);
+        for (std::size_t i = 0, at = cut; i < rowLen.size(); at += rowLen[i++]) starts.push_back(at);
+        if (replaced == ch.added) {
+            const std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(rows.size()) - static_cast<std::ptrdiff_t>(cutEnd - cut);
+            s.csv.replace(cut, cutEnd - cut, rows);
+            for (std::size_t r = firstRow + replaced; r < s.rowStart.size(); ++r) starts.push_back(s.rowStart[r] + shift);
+        }
+        else {
+            std::string rebuilt(s.csv, 0, cut);
+            rebuilt += rows;
+            std::size_t index = firstRow + ch.added;
+            for (std::size_t r = firstRow + replaced; r + 1 < s.rowStart.size(); ++r) {
+                starts.push_back(rebuilt.size());
+                const std::size_t comma = s.csv.find(',', s.rowStart[r]);
+                rebuilt.append(num, std::to_chars(num, num + sizeof num, ++index).ptr);
+                rebuilt.append(s.csv, comma, s.rowStart[r + 1] - comma);
+            }
+            starts.push_back(rebuilt.size());
+            s.csv = std::move(rebuilt);
+        }
+        s.rowStart = std::move(starts);
+
+        // Line offsets and kinds for the new text.
+        std::vector<std::size_t> lineStart(s.lineStart.begin(), s.lineStart.begin() + head);
+        lineStart.insert(lineStart.end(), mid.begin(), mid.end());
+        for (std::size_t k = tailFirst; k < oldLines; ++k) lineStart.push_back(s.lineStart[k] + delta);
+        lineStart.push_back(lineSentinel(text));
+        s.kinds.erase(s.kinds.begin() + head, s.kinds.begin() + tailFirst);
+        s.kinds.insert(s.kinds.begin() + head, kinds.begin(), kinds.end());
+        s.lineStart = std::move(lineStart);
+        s.text = std::move(text);
+
+        if (skipped) std::cout << "  [Warning] Skipped " << skipped << " malformed row(s).\n";
+        ch.ok = true;
+        return ch;
+    }
+
+    // Writes the kept export plus a fresh TOTAL row under a temporary name,
+    // renamed into place so readers never see half a file.
+    bool writeExport(const Session& s, const Project& items, units::System sys) {
+        std::ostringstream os;
+        os << ",\"TOTAL\",\"\",";
+        ui::csvLoadColumns(os, totalLoad(items), sys);
+        os << "\n";
+
+        const std::string tmp = s.outPath + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary);
+            out.write(s.csv.data(), static_cast<std::streamsize>(s.csv.size()));
+            out << os.str();
+            if (!out) return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, s.outPath, ec);
+        return !ec;
+    }
+
+} // namespace watch
+
+// Machine mode (heatloads --json): one JSON object per stdin line, one per
+// stdout line back, e.g.
+//   {"id":7,"method":"hydronic","gpm":10,"dT":20}
+//   {"id":7,"btu_per_hr":100000,"kw":29.308323563892145,"tons":8.333333333333334}
+// "id" is optional and echoed back as given. Inputs are imperial, named per
+// method as in SHAPES; a failed request gets {"id":..,"error":".."} instead.
+//
+// Input is read in blocks of whatever the pipe holds. Each block's complete
+// lines are scanned into columns, evaluated with one calcs::evaluate_batch
+// call and answered with one write, so a tool sending a request at a time
+// still gets its answer at once, and a bulk pipe pays per block, not per line.
+namespace api {
+
+    // JSON keys for a method's a, b, c inputs (evaluate_batch layout); a
+    // missing third key means c = 1, and Internal's diversity defaults to 1.
+    struct Shape {
+        const char* name;
+        calcs::Method method;
+        const char* keys[3];
+    };
+
+    const Shape SHAPES[] = {
+        { "air_sensible", calcs::Method::AirSens, { "cfm", "dT", nullptr } },
+        { "hydronic", calcs::Method::Hydronic, { "gpm", "dT", nullptr } },
+        { "conduction", calcs::Method::Conduction, { "u", "area", "dT" } },
+        { "ach", calcs::Method::AchAir, { "ach", "volume", "dT" } },
+        { "solar", calcs::Method::Solar, { "shgc", "area", "irradiance" } },
+        { "internal", calcs::Method::Internal, { "count", "each", "diversity" } },
+        { "latent", calcs::Method::Latent, { "cfm", "dW", nullptr } },
+    };
+
+    constexpr int MAX_FIELDS = 8; // numeric members kept per request
+
+    struct Request {
+        std::string_view id;     // raw JSON token, empty if absent
+        std::string_view method; // string contents
+        std::string_view keys[MAX_FIELDS];
+        double values[MAX_FIELDS];
+        int count = 0;
+    };
+
+    inline const char* skipSpace(const char* p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        return p;
+    }
+
+    // Past the closing quote of the string starting at p, or nullptr.
+    inline const char* skipString(const char* p, const char* end) {
+        for (++p; p < end; ++p) {
+            if (*p == '\\') ++p;
+            else if (*p == '"') return p + 1;
+        }
+        return nullptr;
+    }
+
+    // Past any JSON value starting at p, nested ones included, or nullptr.
+    const char* skipValue(const char* p, const char* end) {
+        int depth = 0;
+        for (; p < end; ++p) {
+            if (*p == '"') {
+                p = skipString(p, end);
+                if (!p) return nullptr;
+                --p;
+            }
+            else if (*p == '{' || *p == '[') ++depth;
+            else if (*p == '}' || *p == ']') {
+                if (depth == 0) return p;
+                if (--depth == 0) return p + 1;
+            }
+            else if (depth == 0 && (*p == ',' || *p == ' ' || *p == '\t')) return p;
+        }
+        return depth == 0 ? p : nullptr;
+    }
+
+    // Scans one flat object. Returns nullptr on success, else the error.
+    const char* parse(std::string_view line, Request& r) {
+        const char* p = skipSpace(line.data(), line.data() + line.size());
+        const char* end = line.data() + line.size();
+        if (p == end || *p != '{') return "expected a JSON object";
+        p = skipSpace(p + 1, end);
+        if (p < end && *p == '}') return nullptr;
+        while (true) {
+            if (p == end || *p != '"') return "expected a key";
+            const char* k = p + 1;
+            p = skipString(p, end);
+            if (!p) return "unterminated string";
+            std::string_view key(k, static_cast<std::size_t>(p - 1 - k));
+            p = skipSpace(p, end);
+            if (p == end || *p != ':') return "expected ':'";
+            p = skipSpace(p + 1, end);
+
+            const char* v = p;
+            if (p < end && *p == '"') {
+                p = skipString(p, end);
+                if (!p) return "unterminated string";
+                if (key == "method") r.method = std::string_view(v + 1, static_cast<std::size_t>(p - 1 - (v + 1)));
+            }
+            else if (p < end && (*p == '-' || (*p >= '0' && *p <= '9')) && key != "id") {
+                double x;
+                auto res = std::from_chars(p, end, x);
+                if (res.ec != std::errc()) return "bad number";
+                p = res.ptr;
+                if (r.count < MAX_FIELDS) {
+                    r.keys[r.count] = key;
+                    r.values[r.count++] = x;
+                }
+            }
+            else {
+                p = skipValue(p, end);
+                if (!p) return "bad value";
+            }
+            if (key == "id") r.id = std::string_view(v, static_cast<std::size_t>(p - v));
+
+            p = skipSpace(p, end);
+            if (p < end && *p == ',') {
+                p = skipSpace(p + 1, end);
+                continue;
+            }
+            if (p < end && *p == '}') return skipSpace(p + 1, end) == end ? nullptr : "text after the object";
+            return "expected ',' or '}'";
+        }
+    }
+
+    // Fills the batch inputs from a parsed request. Returns nullptr on
+    // success, else the error.
+    const char* inputs(const Request& r, calcs::Method& m, double (&in)[3]) {
+        const Shape* shape = nullptr;
+        for (const Shape& s : SHAPES)
+            if (r.method == s.name) shape = &s;
+        if (!shape) return r.method.empty() ? "missing method" : "unknown method";
+        m = shape->method;
+        for (int k = 0; k < 3; ++k) {
+            in[k] = 1.0;
+            if (!shape->keys[k]) continue;
+            int f = 0;
+            while (f < r.count && r.keys[f] != shape->keys[k]) ++f;
+            if (f < r.count) in[k] = r.values[f];
+            else if (m != calcs::Method::Internal || k != 2) return "missing input";
+        }
+        return nullptr;
+    }
+
+    // Shortest text that reads back exactly; plain digits for everyday
+    // magnitudes, exponent form outside them.
+    void appendNumber(std::string& out, double x) {
+        char buf[64];
+        const double mag = std::fabs(x);
+        const bool plain = (mag >= 1e-6 && mag < 1e15) || x == 0.0;
+        out.append(buf, (plain ? std::to_chars(buf, buf + sizeof buf, x, std::chars_format::fixed)
+            : std::to_chars(buf, buf + sizeof buf, x)).ptr);
+    }
+
+    // One block's requests as columns; kept across blocks so their
+    // capacity is reused.
+    struct Batch {
+        std::vector<std::string_view> ids;
+        std::vector<const char*> errors; // nullptr = evaluated
+        std::vector<calcs::Method> methods;
+        std::vector<double> a, b, c, q;
+
+        void clear() {
+            ids.clear();
+            errors.clear();
+            methods.clear();
+            a.clear();
+            b.clear();
+            c.clear();
+        }
+    };
+
+    // Evaluates and answers the complete lines in text[0, n).
+    std::size_t answer(const char* text, std::size_t n, const calcs::BatchFactors& f, Batch& batch, std::string& out) {
+        std::vector<std::string_view>& ids = batch.ids;
+        std::vector<const char*>& errors = batch.errors;
+        std::vector<calcs::Method>& methods = batch.methods;
+        std::vector<double>& a = batch.a;
+        std::vector<double>& b = batch.b;
+        std::vector<double>& c = batch.c;
+        std::vector<double>& q = batch.q;
+        batch.clear();
+        Request r;
+        for (std::size_t pos = 0; pos < n;) {
+            const char* nl = static_cast<const char*>(std::memchr(text + pos, '\n', n - pos));
+            std::size_t len = (nl ? static_cast<std::size_t>(nl - text) : n) - pos;
+            std::string_view line(text + pos, len);
+            pos += len + 1;
+            if (skipSpace(line.data(), line.data() + line.size()) == line.data() + line.size()) continue;
+
+            r.id = r.method = std::string_view();
+            r.count = 0;
+            calcs::Method m = calcs::Method::AirSens;
+            double in[3] = { 0.0, 0.0, 0.0 };
+            const char* error = parse(line, r);
+            if (!error) error = inputs(r, m, in);
+            ids.push_back(r.id);
+            errors.push_back(error);
+            methods.push_back(m);
+            a.push_back(in[0]);
+            b.push_back(in[1]);
+            c.push_back(in[2]);
+        }
+
+        q.resize(methods.size());
+        calcs::evaluate_batch(methods.data(), a.data(), b.data(), c.data(), q.data(), q.size(), f);
+        for (std::size_t i = 0; i < q.size(); ++i) {
+            out += '{';
+            if (!ids[i].empty()) {
+                out += "\"id\":";
+                out += ids[i];
+                out += ',';
+            }
+            if (!errors[i] && !std::isfinite(q[i])) errors[i] = "result out of range";
+            if (errors[i]) {
+                out += "\"error\":\"";
+                out += errors[i];
+                out += "\"}\n";
+                continue;
+            }
+            const units::BtuHr load(q[i]);
+            out += "\"btu_per_hr\":";
+            appendNumber(out, load.value);
+            out += ",\"kw\":";
+            appendNumber(out, units::btuhr_to_kw(load).value);
+            out += ",\"tons\":";
+            appendNumber(out, units::btuhr_to_ton(load).value);
+            out += "}\n";
+        }
+        return q.size();
+    }
+
+    // Bytes available on stdin, blocking only when there are none; 0 at
+    // end of input.
+    std::size_t readSome(char* buf, std::size_t n) {
+#ifdef __linux__
+        ssize_t got;
+        do got = ::read(0, buf, n);
+        while (got < 0 && errno == EINTR);
+        return got > 0 ? static_cast<std::size_t>(got) : 0;
+#else
+        return std::fread(buf, 1, n, stdin);
+#endif
+    }
+
+    // Serves requests until stdin closes. Returns the number answered.
+    std::size_t serve(const Settings& cfg) {
+        constexpr std::size_t BLOCK_BYTES = std::size_t(1) << 20;
+        const calcs::BatchFactors f = calcs::batchFactors(cfg.airFactor, cfg.fluidFactor);
+        std::vector<char> buf(BLOCK_BYTES);
+        Batch batch;
+        std::string out;
+        std::size_t held = 0, answered = 0;
+        while (true) {
+            if (held == buf.size()) buf.resize(buf.size() * 2); // a line longer than the buffer
+            const std::size_t got = readSome(buf.data() + held, buf.size() - held);
+            if (got == 0) break;
+            held += got;
+
+            // Complete lines only; a partial last line waits for the rest.
+            std::size_t done = held;
+            while (done > 0 && buf[done - 1] != '\n') --done;
+            if (done == 0) continue;
+            out.clear();
+            answered += answer(buf.data(), done, f, batch, out);
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+            std::memmove(buf.data(), buf.data() + done, held - done);
+            held -= done;
+        }
+        if (held) {
+            out.clear();
+            answered += answer(buf.data(), held, f, batch, out);
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+        }
+        return answered;
+    }
+
+} // namespace api
+
+// ------------------------ C API ------------------------
+// Definitions for heatloads.h. Each entry point catches everything, so
+// embedders see a status code, never a C++ exception.
+
+struct hl_project {
+    Project items;
+    Settings cfg;
+};
+
+namespace capi {
+
+    static_assert(HL_AIR_SENSIBLE == static_cast<int>(calcs::Method::AirSens)
+        && HL_CONDUCTION == static_cast<int>(calcs::Method::Conduction)
+        && HL_LATENT == static_cast<int>(calcs::Method::Latent) && HL_LATENT + 1 == calcs::METHOD_COUNT,
+        "hl_method must match calcs::Method");
+
+    thread_local std::string lastError;
+
+    int fail(int status, const char* message) {
+        lastError = message;
+        return status;
+    }
+
+    template <class F>
+    int guard(F f) noexcept {
+        try {
+            lastError.clear();
+            return f();
+        }
+        catch (const std::bad_alloc&) {
+            return fail(HL_ENOMEM, "out of memory");
+        }
+        catch (const std::exception& e) {
+            return fail(HL_EINTERNAL, e.what());
+        }
+        catch (...) {
+            return fail(HL_EINTERNAL, "unexpected error");
+        }
+    }
+
+    bool method(int m, calcs::Method& out) {
+        if (m < 0 || m >= calcs::METHOD_COUNT) return false;
+        out = static_cast<calcs::Method>(m);
+        return true;
+    }
+
+    // Evaluates and appends rows [0, n); names and c may be null. c is
+    // ignored for the two-input methods. The load index is left stale for the
+    // next query, as after an import.
+    int add(hl_project* p, int m, const char* const* names, const double* a, const double* b, const double* c,
+        std::size_t n) {
+        calcs::Method meth;
+        if (!p) return fail(HL_EINVAL, "null project");
+        if (!method(m, meth)) return fail(HL_EINVAL, "unknown method");
+        if (n && (!a || !b)) return fail(HL_EINVAL, "null input array");
+
+        if (!calcs::hasThirdInput(meth)) c = nullptr;
+        std::vector<double> q(n);
+        calcs::evaluate_batch(meth, a, b, c, q.data(), n, calcs::batchFactors(p->cfg.airFactor, p->cfg.fluidFactor));
+        std::string label = std::string(calcs::methodLabel(meth)) + " Load";
+        p->items.byLoad.stale = true;
+        p->items.reserve(p->items.size() + n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const char* name = names ? names[i] : nullptr;
+            p->items.emplace(name && *name ? std::string_view(name) : std::string_view(label), meth, units::BtuHr(q[i]),
+                std::string_view(), std::string_view(), a[i], b[i], c ? c[i] : 1.0, 0);
+        }
+        return HL_OK;
+    }
+
+} // namespace capi
+
+extern "C" {
+
+int hl_api_version(void) { return HL_API_VERSION; }
+
+const char* hl_last_error(void) { return capi::lastError.c_str(); }
+
+int hl_eval_batch3(int method, const double* a, const double* b, const double* c, double* out, size_t n) {
+    return capi::guard([&] {
+        calcs::Method m;
+        if (!capi::method(method, m)) return capi::fail(HL_EINVAL, "unknown method");
+        if (n && (!a || !b || !out)) return capi::fail(HL_EINVAL, "null array");
+        calcs::evaluate_batch(m, a, b, calcs::hasThirdInput(m) ? c : nullptr, out, n);
+        return static_cast<int>(HL_OK);
+    });
+}
+
+int hl_eval_batch(int method, const double* a, const double* b, double* out, size_t n) {
+    return hl_eval_batch3(method, a, b, nullptr, out, n);
+}
+
+int hl_btuhr_to_kw(const double* btuhr, double* out, size_t n) {
+    return capi::guard([&] {
+        if (n && (!btuhr || !out)) return capi::fail(HL_EINVAL, "null array");
+        for (size_t i = 0; i < n; ++i) out[i] = units::btuhr_to_kw(units::BtuHr(btuhr[i])).value;
+        return static_cast<int>(HL_OK);
+    });
+}
+
+int hl_btuhr_to_tons(const double* btuhr, double* out, size_t n) {
+    return capi::guard([&] {
+        if (n && (!btuhr || !out)) return capi::fail(HL_EINVAL, "null array");
+        for (size_t i = 0; i < n; ++i) out[i] = units::btuhr_to_ton(units::BtuHr(btuhr[i])).value;
+        return static_cast<int>(HL_OK);
+    });
+}
+
+hl_project* hl_project_create(void) {
+    hl_project* p = nullptr;
+    capi::guard([&] {
+        p = new hl_project();
+        return static_cast<int>(HL_OK);
+    });
+    return p;
+}
+
+void hl_project_destroy(hl_project* p) { delete p; }
+
+int hl_project_add(hl_project* p, const char* name, int method, double a, double b, double c) {
+    return capi::guard([&] { return capi::add(p, method, &name, &a, &b, &c, 1); });
+}
+
+int hl_project_add_batch(hl_project* p, int method, const char* const* names,
+    const double* a, const double* b, const double* c, size_t n) {
+    return capi::guard([&] { return capi::add(p, method, names, a, b, c, n); });
+}
+
+size_t hl_project_size(const hl_project* p) { return p ? p->items.size() : 0; }
+
+int hl_project_total(const hl_project* p, double* btuhr) {
+    return capi::guard([&] {
+        if (!p || !btuhr) return capi::fail(HL_EINVAL, "null argument");
+        *btuhr = totalLoad(p->items).value;
+        return static_cast<int>(HL_OK);
+    });
+}
+
+int hl_project_export_csv(const hl_project* p, const char* path, int si) {
+    return capi::guard([&] {
+        if (!p || !path) return capi::fail(HL_EINVAL, "null argument");
+        std::ofstream out(path);
+        if (!out) return capi::fail(HL_EIO, "could not write file");
+        const Project& items = p->items;
+        ui::writeLoadsCSV(out, items.size(),
+            [&items](std::size_t i) { return items.name(i); },
+            [&items](std::size_t i) { return items.methods[i]; },
+            [&items](std::size_t i) { return items.btu_per_hr[i]; },
+            totalLoad(items), si ? units::System::SI : units::System::Imperial, p->cfg.memoize);
+        out.close();
+        if (!out) return capi::fail(HL_EIO, "could not write file");
+        return static_cast<int>(HL_OK);
+    });
+}
+
+} // extern "C"
 
 // ------------------------ ITEM BUILDERS ------------------------
 
-LoadItem buildAirSensibleItem() {
+LoadItem buildAirSensibleItem(const Settings& cfg) {
     LoadItem item;
-    item.method = "AirSens";
+    item.method = calcs::Method::AirSens;
 
     item.name = core::readLine("Name (e.g., Supply air, Zone vent): ");
     if (item.name.empty()) item.name = "Air Sensible Load";
 
-    double cfm = core::readDouble("CFM: ", 0.0, 1e9);
-    double dT = core::readDouble("Delta-T (F): ", -200.0, 200.0);
+    if (cfg.system == units::System::SI) {
+        units::Lps lps(core::readDouble("Airflow (L/s): ", 0.0, 1e9));
+        units::DeltaK dT(core::readDouble("Delta-T (K): ", -111.0, 111.0));
 
-    item.btu_per_hr = calcs::air_sensible_btuhr(cfm, dT);
+        units::Watts w = calcs::air_sensible_w(lps, dT, cfg.airFactor);
+        item.btu_per_hr = units::w_to_btuhr(w);
+        item.a = units::lps_to_cfm(lps).value;
+        item.b = units::deltak_to_deltaf(dT).value;
 
-    std::cout << "Result: Qs = 1.08 * " << cfm << " * " << dT
+        std::cout << "Result: Qs = " << ui::formatCoef(calcs::air_w_per_lps_k(cfg.airFactor)) << " * " << lps << " * " << dT
+            << " = " << std::fixed << std::setprecision(1) << w << " W\n";
+        return item;
+    }
+
+    units::Cfm cfm(core::readDouble("CFM: ", 0.0, 1e9));
+    units::DeltaF dT(core::readDouble("Delta-T (F): ", -200.0, 200.0));
+
+    item.btu_per_hr = calcs::air_sensible_btuhr(cfm, dT, cfg.airFactor);
+    item.a = cfm.value;
+    item.b = dT.value;
+
+    std::cout << "Result: Qs = " << ui::formatCoef(cfg.airFactor.value) << " * " << cfm << " * " << dT
         << " = " << std::fixed << std::setprecision(1) << item.btu_per_hr << " BTU/hr\n";
     return item;
 }
 
-LoadItem buildHydronicItem() {
+LoadItem buildHydronicItem(const Settings& cfg) {
     LoadItem item;
-    item.method = "Hydronic";
+    item.method = calcs::Method::Hydronic;
 
     item.name = core::readLine("Name (e.g., HW coil, baseboard loop): ");
     if (item.name.empty()) item.name = "Hydronic Load";
 
-    double gpm = core::readDouble("GPM: ", 0.0, 1e9);
-    double dT = core::readDouble("Delta-T (F): ", -200.0, 200.0);
+    if (cfg.system == units::System::SI) {
+        units::M3h flow(core::readDouble("Flow (m^3/h): ", 0.0, 1e9));
+        units::DeltaK dT(core::readDouble("Delta-T (K): ", -111.0, 111.0));
+
+        units::Watts w = calcs::hydronic_w(flow, dT, cfg.fluidFactor);
+        item.btu_per_hr = units::w_to_btuhr(w);
+        item.a = units::m3h_to_gpm(flow).value;
+        item.b = units::deltak_to_deltaf(dT).value;
+
+        std::cout << "Result: Q = " << ui::formatCoef(calcs::water_w_per_m3h_k(cfg.fluidFactor))
+            << " * " << flow << " * " << dT << " = " << std::fixed << std::setprecision(1) << w << " W\n";
+        return item;
+    }
+
+    units::Gpm gpm(core::readDouble("GPM: ", 0.0, 1e9));
+    units::DeltaF dT(core::readDouble("Delta-T (F): ", -200.0, 200.0));
 
-    item.btu_per_hr = calcs::hydronic_btuhr(gpm, dT);
+    item.btu_per_hr = calcs::hydronic_btuhr(gpm, dT, cfg.fluidFactor);
+    item.a = gpm.value;
+    item.b = dT.value;
 
-    std::cout << "Result: Q = 500 * " << gpm << " * " << dT
+    std::cout << "Result: Q = " << ui::formatCoef(cfg.fluidFactor.value) << " * " << gpm << " * " << dT
         << " = " << std::fixed << std::setprecision(1) << item.btu_per_hr << " BTU/hr\n";
     return item;
 }
 
-LoadItem buildConductionItem() {
+// Lists the library and returns the chosen assembly id, or 0 if the library
+// is empty or absent.
+std::uint32_t pickAssembly(const envelope::Library* lib, units::System sys) {
+    if (!lib || lib->size() == 0) return 0;
+    for (std::uint32_t id = 1; id <= lib->size(); ++id) {
+        std::cout << "  " << id << ") " << lib->assemblies[id].name << "  U = " << std::fixed << std::setprecision(4);
+        if (sys == units::System::SI) std::cout << lib->u[id].value / units::U_PER_U_SI << " W/m^2·K\n";
+        else std::cout << lib->u[id] << " BTU/hr·ft^2·F\n";
+    }
+    return static_cast<std::uint32_t>(core::readInt("Assembly: ", 1, static_cast<int>(lib->size())));
+}
+
+LoadItem buildConductionItem(const Settings& cfg, const envelope::Library* lib = nullptr) {
     LoadItem item;
-    item.method = "Cond(UA)";
+    item.method = calcs::Method::Conduction;
 
     item.name = core::readLine("Name (e.g., Exterior wall, Roof, Glass): ");
     if (item.name.empty()) item.name = "Conduction Load";
 
+    const bool si = (cfg.system == units::System::SI);
     std::cout << "\nChoose input form:\n";
-    std::cout << "  1) U-value directly (BTU/hr·ft^2·F)\n";
-    std::cout << "  2) R-value (hr·ft^2·F/BTU)  -> U = 1/R\n";
-    int mode = core::readInt("Select: ", 1, 2);
+    if (si) {
+        std::cout << "  1) U-value directly (W/m^2·K)\n";
+        std::cout << "  2) R-value (m^2·K/W)  -> U = 1/R\n";
+    }
+    else {
+        std::cout << "  1) U-value directly (BTU/hr·ft^2·F)\n";
+        std::cout << "  2) R-value (hr·ft^2·F/BTU)  -> U = 1/R\n";
+    }
+    const bool haveLibrary = lib && lib->size() > 0;
+    if (haveLibrary) std::cout << "  3) Assembly from library\n";
+    int mode = core::readInt("Select: ", 1, haveLibrary ? 3 : 2);
+
+    if (si) {
+        units::SqM area(core::readDouble("Area (m^2): ", 0.0, 1e11));
+        units::DeltaK dT(core::readDouble("Delta-T (K): ", -111.0, 111.0));
+
+        units::UValueSI U;
+        if (mode == 1) {
+            U = units::UValueSI(core::readDouble("U-value: ", 0.0, 1e6));
+        }
+        else if (mode == 2) {
+            units::RValueSI R(core::readDouble("R-value: ", 0.000001, 1e12));
+            U = units::usi_from_rsi(R);
+            std::cout << "Computed U = 1/R = " << std::fixed << std::setprecision(6) << U << "\n";
+        }
+        else {
+            item.assembly = pickAssembly(lib, cfg.system);
+            U = units::UValueSI(lib->u[item.assembly].value / units::U_PER_U_SI);
+        }
+
+        units::Watts w = calcs::conduction_w(U, area, dT);
+        item.btu_per_hr = units::w_to_btuhr(w);
+        item.a = (mode == 3) ? lib->u[item.assembly].value : units::usi_to_u(U).value;
+        item.b = units::sqm_to_sqft(area).value;
+        item.c = units::deltak_to_deltaf(dT).value;
 
-    double area = core::readDouble("Area (ft^2): ", 0.0, 1e12);
-    double dT = core::readDouble("Delta-T (F): ", -200.0, 200.0);
+        std::cout << "Result: Q = U * A * dT = " << std::fixed << std::setprecision(6) << U
+            << " * " << std::setprecision(1) << area << " * " << dT
+            << " = " << std::setprecision(1) << w << " W\n";
+        return item;
+    }
+
+    units::SqFt area(core::readDouble("Area (ft^2): ", 0.0, 1e12));
+    units::DeltaF dT(core::readDouble("Delta-T (F): ", -200.0, 200.0));
 
-    double U = 0.0;
+    units::UValue U;
     if (mode == 1) {
-        U = core::readDouble("U-value: ", 0.0, 1e6);
+        U = units::UValue(core::readDouble("U-value: ", 0.0, 1e6));
     }
-    else {
-        double R = core::readDouble("R-value: ", 0.000001, 1e12);
-        U = 1.0 / R;
+    else if (mode == 2) {
+        units::RValue R(core::readDouble("R-value: ", 0.000001, 1e12));
+        U = units::u_from_r(R);
         std::cout << "Computed U = 1/R = " << std::fixed << std::setprecision(6) << U << "\n";
     }
+    else {
+        item.assembly = pickAssembly(lib, cfg.system);
+        U = lib->u[item.assembly];
+    }
 
     item.btu_per_hr = calcs::conduction_btuhr(U, area, dT);
+    item.a = U.value;
+    item.b = area.value;
+    item.c = dT.value;
 
     std::cout << "Result: Q = U * A * dT = " << std::fixed << std::setprecision(6) << U
         << " * " << std::setprecision(1) << area << " * " << dT
@@ -259,27 +4483,162 @@ LoadItem buildConductionItem() {
     return item;
 }
 
-LoadItem buildACHItem() {
+LoadItem buildACHItem(const Settings& cfg) {
     LoadItem item;
-    item.method = "ACH->Air";
+    item.method = calcs::Method::AchAir;
 
     item.name = core::readLine("Name (e.g., Infiltration, Ventilation): ");
     if (item.name.empty()) item.name = "ACH Air Load";
 
-    double volume = core::readDouble("Zone volume (ft^3): ", 0.0, 1e18);
-    double ach = core::readDouble("ACH (air changes per hour): ", 0.0, 1e6);
-    double dT = core::readDouble("Delta-T (F): ", -200.0, 200.0);
+    if (cfg.system == units::System::SI) {
+        units::CuM volume(core::readDouble("Zone volume (m^3): ", 0.0, 1e17));
+        units::Ach ach(core::readDouble("ACH (air changes per hour): ", 0.0, 1e6));
+        units::DeltaK dT(core::readDouble("Delta-T (K): ", -111.0, 111.0));
+
+        units::Lps lps = calcs::lps_from_ach(ach, volume);
+        units::Watts w = calcs::air_sensible_w(lps, dT, cfg.airFactor);
+        item.btu_per_hr = units::w_to_btuhr(w);
+        item.a = ach.value;
+        item.b = units::cum_to_cuft(volume).value;
+        item.c = units::deltak_to_deltaf(dT).value;
+
+        std::string k = ui::formatCoef(calcs::air_w_per_lps_k(cfg.airFactor));
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "L/s = ACH * Volume / 3.6 = " << ach << " * " << volume << " / 3.6 = " << lps << "\n";
+        std::cout << "Qs  = " << k << " * L/s * dT = " << k << " * " << lps << " * " << dT
+            << " = " << std::setprecision(1) << w << " W\n";
+        return item;
+    }
+
+    units::CuFt volume(core::readDouble("Zone volume (ft^3): ", 0.0, 1e18));
+    units::Ach ach(core::readDouble("ACH (air changes per hour): ", 0.0, 1e6));
+    units::DeltaF dT(core::readDouble("Delta-T (F): ", -200.0, 200.0));
 
-    double cfm = calcs::cfm_from_ach(ach, volume);
-    item.btu_per_hr = calcs::air_sensible_btuhr(cfm, dT);
+    units::Cfm cfm = calcs::cfm_from_ach(ach, volume);
+    item.btu_per_hr = calcs::air_sensible_btuhr(cfm, dT, cfg.airFactor);
+    item.a = ach.value;
+    item.b = volume.value;
+    item.c = dT.value;
 
+    std::string k = ui::formatCoef(cfg.airFactor.value);
     std::cout << std::fixed << std::setprecision(2);
     std::cout << "CFM = ACH * Volume / 60 = " << ach << " * " << volume << " / 60 = " << cfm << "\n";
-    std::cout << "Qs  = 1.08 * CFM * dT   = 1.08 * " << cfm << " * " << dT
+    std::cout << "Qs  = " << k << " * CFM * dT   = " << k << " * " << cfm << " * " << dT
         << " = " << std::setprecision(1) << item.btu_per_hr << " BTU/hr\n";
     return item;
 }
 
+LoadItem buildSolarItem(const Settings& cfg) {
+    LoadItem item;
+    item.method = calcs::Method::Solar;
+
+    item.name = core::readLine("Name (e.g., West glazing, Skylights): ");
+    if (item.name.empty()) item.name = "Solar Gain";
+
+    double shgc = core::readDouble("SHGC (0-1): ", 0.0, 1.0);
+
+    if (cfg.system == units::System::SI) {
+        units::SqM area(core::readDouble("Glass area (m^2): ", 0.0, 1e15));
+        units::IrradianceSI irr(core::readDouble("Irradiance (W/m^2): ", 0.0, 1500.0));
+
+        units::Watts w = calcs::solar_w(shgc, area, irr);
+        item.btu_per_hr = units::w_to_btuhr(w);
+        item.a = shgc;
+        item.b = units::sqm_to_sqft(area).value;
+        item.c = units::irrsi_to_irr(irr).value;
+
+        std::cout << "Result: Q = SHGC * A * I = " << shgc << " * " << area << " * " << irr
+            << " = " << std::fixed << std::setprecision(1) << w << " W\n";
+        return item;
+    }
+
+    units::SqFt area(core::readDouble("Glass area (ft^2): ", 0.0, 1e16));
+    units::Irradiance irr(core::readDouble("Irradiance (BTU/hr·ft^2): ", 0.0, 500.0));
+
+    item.btu_per_hr = calcs::solar_btuhr(shgc, area, irr);
+    item.a = shgc;
+    item.b = area.value;
+    item.c = irr.value;
+
+    std::cout << "Result: Q = SHGC * A * I = " << shgc << " * " << area << " * " << irr
+        << " = " << std::fixed << std::setprecision(1) << item.btu_per_hr << " BTU/hr\n";
+    return item;
+}
+
+LoadItem buildInternalItem(const Settings& cfg) {
+    LoadItem item;
+    item.method = calcs::Method::Internal;
+
+    std::cout << "Source: 1) People  2) Lighting  3) Equipment\n";
+    int src = core::readInt("Select: ", 1, 3);
+
+    item.name = core::readLine("Name (e.g., Office occupants, Server rack): ");
+    if (item.name.empty()) item.name = (src == 1) ? "People" : (src == 2) ? "Lighting" : "Equipment";
+
+    double count;
+    units::BtuHr perUnit;
+    if (src == 1) {
+        count = core::readDouble("Number of people: ", 0.0, 1e9);
+        const bool si = (cfg.system == units::System::SI);
+        double each = core::readDouble(si ? "Sensible gain per person (W, 0 = 73): " : "Sensible gain per person (BTU/hr, 0 = 250): ",
+            0.0, si ? 1000.0 : 3500.0);
+        if (each == 0.0) perUnit = units::BtuHr(calcs::BTUHR_PER_PERSON);
+        else perUnit = si ? units::w_to_btuhr(units::Watts(each)) : units::BtuHr(each);
+    }
+    else {
+        count = core::readDouble("Connected load (W): ", 0.0, 1e12);
+        perUnit = units::w_to_btuhr(units::Watts(1.0));
+    }
+    double diversity = core::readDouble("Diversity / usage factor (0-1): ", 0.0, 1.0);
+
+    item.btu_per_hr = calcs::internal_btuhr(count, perUnit, diversity);
+    item.a = count;
+    item.b = perUnit.value;
+    item.c = diversity;
+
+    std::cout << std::fixed << std::setprecision(1);
+    if (cfg.system == units::System::SI)
+        std::cout << "Result: Q = " << count << " * " << ui::formatCoef(units::btuhr_to_w(perUnit).value) << " W * " << std::setprecision(2) << diversity
+            << " = " << std::setprecision(1) << units::btuhr_to_w(item.btu_per_hr) << " W\n";
+    else
+        std::cout << "Result: Q = " << count << " * " << ui::formatCoef(perUnit.value) << " * " << std::setprecision(2) << diversity
+            << " = " << std::setprecision(1) << item.btu_per_hr << " BTU/hr\n";
+    return item;
+}
+
+LoadItem buildLatentItem(const Settings& cfg) {
+    LoadItem item;
+    item.method = calcs::Method::Latent;
+
+    item.name = core::readLine("Name (e.g., Outdoor air, Infiltration): ");
+    if (item.name.empty()) item.name = "Latent Load";
+
+    if (cfg.system == units::System::SI) {
+        units::Lps lps(core::readDouble("Airflow (L/s): ", 0.0, 1e9));
+        units::HumRatio dW(core::readDouble("Humidity ratio difference (kg/kg): ", -0.1, 0.1));
+
+        units::Watts w = calcs::latent_w(lps, dW, cfg.airFactor);
+        item.btu_per_hr = units::w_to_btuhr(w);
+        item.a = units::lps_to_cfm(lps).value;
+        item.b = dW.value;
+
+        std::cout << "Result: Ql = " << ui::formatCoef(calcs::latent_w_per_lps(cfg.airFactor)) << " * " << lps << " * " << ui::formatCoef(dW.value)
+            << " = " << std::fixed << std::setprecision(1) << w << " W\n";
+        return item;
+    }
+
+    units::Cfm cfm(core::readDouble("CFM: ", 0.0, 1e9));
+    units::HumRatio dW(core::readDouble("Humidity ratio difference (lb/lb): ", -0.1, 0.1));
+
+    item.btu_per_hr = calcs::latent_btuhr(cfm, dW, cfg.airFactor);
+    item.a = cfm.value;
+    item.b = dW.value;
+
+    std::cout << "Result: Ql = " << ui::formatCoef(calcs::latent_factor(cfg.airFactor)) << " * " << cfm << " * " << ui::formatCoef(dW.value)
+        << " = " << std::fixed << std::setprecision(1) << item.btu_per_hr << " BTU/hr\n";
+    return item;
+}
+
 // ------------------------ MENUS ------------------------
 
 void conversionsMenu() {
@@ -290,34 +4649,354 @@ void conversionsMenu() {
         std::cout << "1) BTU/hr -> kW & Tons\n";
         std::cout << "2) kW -> BTU/hr\n";
         std::cout << "3) Tons -> BTU/hr\n";
+        std::cout << "4) Moist Air (dry bulb, RH -> W, h)\n";
         std::cout << "0) Back\n";
 
-        int c = core::readInt("Select: ", 0, 3);
+        int c = core::readInt("Select: ", 0, 4);
         if (c == 0) return;
 
         if (c == 1) {
-            double btu = core::readDouble("BTU/hr: ", -1e18, 1e18);
+            units::BtuHr btu(core::readDouble("BTU/hr: ", -1e18, 1e18));
             std::cout << std::fixed << std::setprecision(3)
                 << "kW   = " << units::btuhr_to_kw(btu) << "\n"
                 << "Tons = " << units::btuhr_to_ton(btu) << "\n";
             core::pause();
         }
         else if (c == 2) {
-            double kw = core::readDouble("kW: ", -1e18, 1e18);
+            units::Kw kw(core::readDouble("kW: ", -1e18, 1e18));
             std::cout << std::fixed << std::setprecision(1)
                 << "BTU/hr = " << units::kw_to_btuhr(kw) << "\n";
             core::pause();
         }
         else if (c == 3) {
-            double ton = core::readDouble("Tons: ", -1e18, 1e18);
+            units::Tons ton(core::readDouble("Tons: ", -1e18, 1e18));
             std::cout << std::fixed << std::setprecision(1)
                 << "BTU/hr = " << units::ton_to_btuhr(ton) << "\n";
             core::pause();
         }
+        else if (c == 4) {
+            units::DegF t(core::readDouble("Dry bulb (F): ", -140.0, 390.0));
+            double rh = core::readDouble("Relative humidity (%): ", 0.0, 100.0) / 100.0;
+            double p = psychro::pressure_psia(core::readDouble("Altitude (ft): ", 0.0, props::ALT_MAX_FT));
+
+            double pws = psychro::saturation_pressure_ref(t);
+            units::HumRatio w = psychro::humidity_ratio_ref(t, rh, p);
+            std::cout << std::fixed << std::setprecision(3) << "P    = " << p << " psia\n"
+                << std::setprecision(5) << "Pws  = " << pws << " psia\n"
+                << std::setprecision(5) << "W    = " << w << " lb/lb (" << std::setprecision(1) << w.value * 7000.0 << " gr/lb)\n"
+                << std::setprecision(2) << "h    = " << psychro::enthalpy(t, w) << " BTU/lb dry air\n";
+            core::pause();
+        }
+    }
+}
+
+void assemblyMenu(Project& items, units::System sys) {
+    const bool si = (sys == units::System::SI);
+    const double rShow = si ? units::U_PER_U_SI : 1.0; // imperial R -> displayed R
+    while (true) {
+        std::cout << "\n=============================\n";
+        std::cout << " ASSEMBLY LIBRARY\n";
+        std::cout << "=============================\n";
+        std::cout << "1) List Assemblies\n";
+        std::cout << "2) Load Library File\n";
+        std::cout << "3) Define Assembly\n";
+        std::cout << "0) Back\n";
+
+        int c = core::readInt("Select: ", 0, 3);
+        if (c == 0) return;
+
+        const envelope::Library& lib = items.library;
+        if (c == 1) {
+            if (lib.size() == 0) std::cout << "\n(No assemblies yet.)\n";
+            for (std::uint32_t id = 1; id <= lib.size(); ++id) {
+                const envelope::Assembly& a = lib.assemblies[id];
+                std::cout << "\n" << id << ") " << a.name << "  (framing " << std::fixed << std::setprecision(0)
+                    << a.framingFraction * 100.0 << "%)\n";
+                std::cout << std::setprecision(2) << "     Films: inside R " << a.insideFilm.value * rShow
+                    << ", outside R " << a.outsideFilm.value * rShow << "\n";
+                for (const envelope::Layer& l : a.layers)
+                    std::cout << "     " << std::left << std::setw(26) << l.name.substr(0, 25) << std::right
+                        << " R " << std::setw(7) << l.r.value * rShow << "  framing R " << std::setw(7) << l.rFraming.value * rShow << "\n";
+                std::cout << std::setprecision(4) << "     U-effective = " << lib.u[id].value / (si ? units::U_PER_U_SI : 1.0)
+                    << (si ? " W/m^2·K\n" : " BTU/hr·ft^2·F\n");
+            }
+            core::pause();
+            continue;
+        }
+
+        if (c == 2) {
+            std::string path = core::readLine("Library CSV path: ");
+            if (path.empty() || io::importAssemblies(path, items.library) < 0) {
+                core::pause();
+                continue;
+            }
+        }
+        else if (c == 3) {
+            envelope::Assembly a;
+            a.name = core::readLine("Assembly name: ");
+            if (a.name.empty()) continue;
+            a.framingFraction = core::readDouble("Framing fraction (0-1, e.g., 0.23): ", 0.0, 1.0);
+            int n = core::readInt("Number of layers (excluding air films): ", 1, 50);
+            const char* unit = si ? " (m^2·K/W): " : " (hr·ft^2·F/BTU): ";
+            for (int k = 0; k < n; ++k) {
+                envelope::Layer l;
+                l.name = core::readLine("  Layer " + std::to_string(k + 1) + " name: ");
+                l.r = units::RValue(core::readDouble("  R along cavity" + std::string(unit), 0.0, 1e6) / rShow);
+                l.rFraming = (a.framingFraction > 0.0)
+                    ? units::RValue(core::readDouble("  R along framing" + std::string(unit), 0.0, 1e6) / rShow)
+                    : l.r;
+                a.layers.push_back(l);
+            }
+            std::uint32_t id = items.library.define(a);
+            std::cout << std::fixed << std::setprecision(4) << "U-effective = "
+                << items.library.u[id].value / (si ? units::U_PER_U_SI : 1.0) << "\n";
+        }
+
+        // Surfaces that reference a redefined assembly pick up its new U.
+        items.reevaluateAssemblies();
+        core::pause();
+    }
+}
+
+// Bases entered as "55,60,65"; blank keeps the default.
+std::vector<double> readBaseList(const std::string& prompt, double fallback) {
+    std::vector<double> bases;
+    for (const std::string& f : io::splitCSV(core::readLine(prompt))) {
+        double v;
+        if (io::parseNumber(f, v) && std::isfinite(v)) bases.push_back(v);
+    }
+    if (bases.empty()) bases.push_back(fallback);
+    return bases;
+}
+
+void annualEnergyMenu(const Project& items, const Settings& cfg) {
+    const bool si = (cfg.system == units::System::SI);
+    std::string path = core::readLine("Hourly weather file (one temperature per line, last field): ");
+    if (path.empty()) return;
+
+    energy::DegreeHours dh;
+    if (io::importWeather(path, dh) <= 0) return;
+    if (dh.hours != 8760 && dh.hours != 8784)
+        std::cout << "  [Warning] Not a full year; totals cover " << dh.hours << " hour(s).\n";
+
+    const double ua = items.coefficient(calcs::DtSource::Outdoor);
+    std::cout << "\nUA (air, conduction, ACH) = " << std::fixed << std::setprecision(1)
+        << (si ? ua * units::F_PER_K / units::BTU_PER_HR_PER_W : ua) << (si ? " W/K\n" : " BTU/hr·F\n");
+    if (ua == 0.0) std::cout << "(No air, conduction or ACH items; annual energy is zero.)\n";
+
+    // Bases and degree-days are shown in the active system; the bins are in F.
+    auto toF = [si](double t) { return si ? t * units::F_PER_K + 32.0 : t; };
+    const double ddScale = si ? 1.0 / (24.0 * units::F_PER_K) : 1.0 / 24.0;
+    const char* unit = si ? "C" : "F";
+
+    std::vector<double> heatBases = readBaseList(si ? "Heating base temps (C, e.g. 15,18; blank = 18): "
+        : "Heating base temps (F, e.g. 55,60,65; blank = 65): ", si ? 18.0 : 65.0);
+    std::vector<double> coolBases = readBaseList(si ? "Cooling base temps (C, blank = 18): "
+        : "Cooling base temps (F, blank = 65): ", si ? 18.0 : 65.0);
+    double eff = core::readDouble("Heating efficiency (0-1, 0 = 0.9): ", 0.0, 1.0);
+    if (eff == 0.0) eff = 0.9;
+    double cop = core::readDouble("Cooling COP (0 = 3.0): ", 0.0, 20.0);
+    if (cop == 0.0) cop = 3.0;
+
+    std::cout << "\n" << std::right << std::setw(10) << (std::string("Base ") + unit)
+        << std::setw(12) << "HDD" << std::setw(16) << "Heat MMBTU" << std::setw(14) << "Therms" << "\n";
+    for (double b : heatBases) {
+        double dhH = dh.heating(units::DegF(toF(b)));
+        double btu = energy::annual_btu(ua, dhH);
+        std::cout << std::setw(10) << std::setprecision(1) << b << std::setw(12) << dhH * ddScale
+            << std::setw(16) << std::setprecision(2) << btu / 1e6
+            << std::setw(14) << std::setprecision(0) << energy::therms(btu, eff) << "\n";
+    }
+
+    std::cout << "\n" << std::setw(10) << (std::string("Base ") + unit)
+        << std::setw(12) << "CDD" << std::setw(16) << "Cool MMBTU" << std::setw(14) << "kWh" << "\n";
+    for (double b : coolBases) {
+        double dhC = dh.cooling(units::DegF(toF(b)));
+        double btu = energy::annual_btu(ua, dhC);
+        std::cout << std::setw(10) << std::setprecision(1) << b << std::setw(12) << dhC * ddScale
+            << std::setw(16) << std::setprecision(2) << btu / 1e6
+            << std::setw(14) << std::setprecision(0) << energy::kwh(btu, cop) << "\n";
+    }
+    std::cout << "(Envelope and air loads only; solar, internal and latent gains are peak values.)\n";
+}
+
+// Re-totals the project for a changed design ΔT from the per-source
+// coefficients, without touching the items.
+void designWhatIf(const Project& items, units::System sys) {
+    const bool si = (sys == units::System::SI);
+    const double toF = si ? units::F_PER_K : 1.0;
+    double shift[calcs::DT_SOURCE_COUNT] = {};
+    shift[static_cast<int>(calcs::DtSource::Outdoor)] =
+        core::readDouble(si ? "Change in indoor-outdoor dT (K, added to every row): " : "Change in indoor-outdoor dT (F, added to every row): ",
+            -200.0, 200.0) * toF;
+    shift[static_cast<int>(calcs::DtSource::Water)] =
+        core::readDouble(si ? "Change in hydronic dT (K): " : "Change in hydronic dT (F): ", -200.0, 200.0) * toF;
+
+    std::cout << "\n" << std::left << std::setw(32) << "Outdoor-dT loads, now:" << std::right;
+    ui::printLoadColumns(std::cout, items.sourceLoad(calcs::DtSource::Outdoor), sys);
+    std::cout << "\n" << std::left << std::setw(32) << "Project total, now:" << std::right;
+    ui::printLoadColumns(std::cout, totalLoad(items), sys);
+    std::cout << "\n" << std::left << std::setw(32) << "Project total, revised:" << std::right;
+    ui::printLoadColumns(std::cout, items.totalWithShift(shift), sys);
+    std::cout << "\n";
+}
+
+// Best-fit units per zone and for the whole project from the equipment
+// catalog, all rated at one entering temperature.
+void sizingMenu(Project& items, units::System sys) {
+    const bool si = (sys == units::System::SI);
+    if (items.catalog.size() == 0 || core::yesNo("Load a different catalog?")) {
+        std::string path = core::readLine("Catalog CSV path (Model,EnteringTemp,Capacity): ");
+        if (path.empty() || io::importCatalog(path, items.catalog) <= 0) return;
+    }
+    if (items.empty()) {
+        std::cout << "\n(No items to size.)\n";
+        return;
+    }
+
+    double t = core::readDouble(si ? "Entering air temp at design (C): " : "Entering air temp at design (F): ", -100.0, 200.0);
+    sizing::RatedIndex idx = sizing::rate(items.catalog, units::DegF(si ? t * units::F_PER_K + 32.0 : t));
+    if (idx.capacity.empty()) {
+        std::cout << "  [Error] No catalog model has capacity at that temperature.\n";
+        return;
+    }
+
+    auto load = [si](double btu) { return si ? btu / units::BTU_PER_HR_PER_KW : units::btuhr_to_ton(units::BtuHr(btu)).value; };
+    std::cout << "\n------------------ EQUIPMENT SIZING ------------------\n";
+    std::cout << std::left << std::setw(24) << "Zone" << std::setw(22) << "Model" << std::right
+        << std::setw(12) << (si ? "Load kW" : "Load Tons") << std::setw(7) << "Units"
+        << std::setw(12) << (si ? "Each kW" : "Each Tons") << std::setw(10) << "Over" << "\n";
+    std::cout << std::string(87, '-') << "\n";
+
+    auto row = [&](const std::string& zone, units::BtuHr q) {
+        sizing::Pick p = sizing::select(idx, q);
+        std::cout << std::left << std::setw(24) << zone.substr(0, 23)
+            << std::setw(22) << (p.units ? items.catalog.models[p.model].substr(0, 21) : std::string_view("-"))
+            << std::right << std::fixed << std::setprecision(2) << std::setw(12) << load(q.value)
+            << std::setw(7) << p.units << std::setw(12) << load(p.capacity);
+        if (p.units) std::cout << std::setw(9) << std::setprecision(1) << (p.units * p.capacity / q.value - 1.0) * 100.0 << "%";
+        std::cout << "\n";
+    };
+
+    for (const query::GroupRow& g : query::groupBy(items, query::GroupBy::Zone))
+        row(g.key.empty() ? "(no zone)" : g.key, g.total);
+    std::cout << std::string(87, '-') << "\n";
+    row("PROJECT", totalLoad(items));
+    std::cout << "----------------------------------------------------------\n\n";
+}
+
+// Lists the project variables and sets one; every formula row is then
+// re-evaluated. Values are in the units of the files that use them.
+void variablesMenu(Project& items, const Settings& cfg) {
+    std::cout << "\n---------------- VARIABLES ----------------\n";
+    if (items.vars.size() == 0) std::cout << "(None yet. Project files set them with \"# let name = value\".)\n";
+    for (std::uint32_t k = 0; k < items.vars.size(); ++k) {
+        std::cout << std::left << std::setw(24) << items.vars.names[k] << std::right;
+        if (items.vars.defined[k]) std::cout << std::setprecision(6) << std::defaultfloat << items.vars.values[k] << "\n";
+        else std::cout << "(undefined, taken as 0)\n";
+    }
+    std::cout << "-------------------------------------------\n";
+
+    std::string name = core::readLine("Variable to set (blank = back): ");
+    if (name.empty()) return;
+    if (!expr::nameStart(name[0]) || !std::all_of(name.begin(), name.end(), expr::nameChar)) {
+        std::cout << "  [Error] Names are letters, digits and '_', not starting with a digit.\n";
+        return;
+    }
+    std::string text = core::readLine("Value or formula (e.g., 40*30): ");
+    expr::Program p;
+    if (!expr::compile(text, items.vars, p)) {
+        std::cout << "  [Error] Could not read that formula.\n";
+        return;
+    }
+    items.vars.set(items.vars.id(name), expr::run(p, items.vars.values.data()));
+    std::size_t n = items.reevaluateFormulas(calcs::batchFactors(cfg.airFactor, cfg.fluidFactor));
+    std::cout << "  " << name << " = " << std::setprecision(6) << std::defaultfloat << items.vars.values[items.vars.id(name)]
+        << "; re-evaluated " << n << " formula item(s).\n";
+}
+
+// Keeps the project in step with a CSV file as it is edited, rewriting the
+// export and reporting the total after every save. Enter stops watching.
+void watchMenu(Project& items, const Settings& cfg) {
+#ifdef __linux__
+    if (!items.empty() && !core::yesNo("Replace the current project with the watched file?")) return;
+    watch::Session s;
+    s.path = core::readLine("Project CSV to watch: ");
+    if (s.path.empty()) return;
+    s.outPath = core::readLine("Export CSV path (kept up to date): ");
+    if (s.outPath.empty()) return;
+    std::error_code ec;
+    if (std::filesystem::weakly_canonical(s.outPath, ec) == std::filesystem::weakly_canonical(s.path, ec)) {
+        std::cout << "  [Error] Export path must differ from the watched file.\n";
+        return;
+    }
+    if (!cfg.memoize) s.cells = memo::TextCache(0);
+
+    const std::filesystem::path file = std::filesystem::absolute(s.path, ec);
+    const std::string name = file.filename().string();
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cout << "  ***Error*** Could not watch: " << s.path << "\n";
+        if (fd >= 0) close(fd);
+        return;
+    }
+
+    auto update = [&]() {
+        auto t0 = std::chrono::steady_clock::now();
+        watch::Change ch = watch::refresh(s, items, cfg);
+        if (!ch.ok) {
+            std::cout << "  ***Error*** Could not read file: " << s.path << "\n";
+            return;
+        }
+        if (!ch.full && ch.removed == 0 && ch.added == 0) return; // saved without changes
+        if (!watch::writeExport(s, items, cfg.system)) std::cout << "  ***Error*** Could not write file: " << s.outPath << "\n";
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        units::BtuHr total = totalLoad(items);
+        std::cout << "  " << (ch.full ? "Loaded " : "Updated ") << ch.added << " row(s)";
+        if (!ch.full && ch.removed != ch.added) std::cout << " (was " << ch.removed << ")";
+        std::cout << ", " << items.size() << " item(s), total ";
+        if (cfg.system == units::System::SI) std::cout << std::fixed << std::setprecision(3) << units::btuhr_to_kw(total) << " kW";
+        else std::cout << std::fixed << std::setprecision(1) << total << " BTU/hr";
+        std::cout << " [" << std::setprecision(1) << ms << " ms]\n";
+    };
+
+    update();
+    std::cout << "  Watching " << s.path << " -- press Enter to stop.\n";
+    pollfd fds[2] = { { fd, POLLIN, 0 }, { STDIN_FILENO, POLLIN, 0 } };
+    alignas(inotify_event) char events[4096];
+    while (poll(fds, 2, -1) >= 0) {
+        if (fds[1].revents) {
+            std::string ignored;
+            std::getline(std::cin, ignored);
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) continue;
+        bool touched = false;
+        ssize_t len;
+        while ((len = read(fd, events, sizeof events)) > 0) {
+            for (char* p = events; p < events + len;) {
+                const inotify_event* ev = reinterpret_cast<const inotify_event*>(p);
+                if (ev->len && name == ev->name) touched = true;
+                p += sizeof(inotify_event) + ev->len;
+            }
+        }
+        if (touched) update();
     }
+    close(fd);
+#else
+    (void)items;
+    (void)cfg;
+    std::cout << "  [Error] Watch mode needs Linux (inotify).\n";
+#endif
 }
 
-void projectMenu(std::vector<LoadItem>& items) {
+void projectMenu(Project& items, const Settings& cfg) {
+    const units::System sys = cfg.system;
+    auto addItem = [&items](const LoadItem& item) {
+        items.emplace(item.name, item.method, item.btu_per_hr, items.activeZone, items.activeTag,
+            item.a, item.b, item.c, item.assembly);
+    };
+
     while (true) {
         std::cout << "\n=============================\n";
         std::cout << " PROJECT MODE (Build & Sum)\n";
@@ -330,19 +5009,38 @@ void projectMenu(std::vector<LoadItem>& items) {
         std::cout << "6) Remove Item\n";
         std::cout << "7) Export CSV\n";
         std::cout << "8) Clear Project\n";
+        std::cout << "9) Import Project CSV\n";
+        std::cout << "10) Group Summary (method/zone/tag)\n";
+        std::cout << "11) Set Zone/Tag for new items"
+            << " (now: " << (items.activeZone.empty() ? "-" : items.activeZone)
+            << " / " << (items.activeTag.empty() ? "-" : items.activeTag) << ")\n";
+        std::cout << "12) Largest Loads (top N)\n";
+        std::cout << "13) Loads Above Threshold\n";
+        std::cout << "14) Find by Name (remove/edit matches)\n";
+        std::cout << "15) Bulk Remove / Scale\n";
+        std::cout << "16) Assembly Library (" << items.library.size() << ")\n";
+        std::cout << "17) Import Envelope Surfaces\n";
+        std::cout << "18) Add Solar Gain (SHGC, A, I)\n";
+        std::cout << "19) Add Internal Gain (people/lights/equip)\n";
+        std::cout << "20) Add Latent Air Load (CFM, dW)\n";
+        std::cout << "21) Annual Energy (hourly weather file)\n";
+        std::cout << "22) Design dT What-If\n";
+        std::cout << "23) Size Equipment (catalog)\n";
+        std::cout << "24) Watch Project CSV (live totals)\n";
+        std::cout << "25) Variables (" << items.vars.size() << ")\n";
         std::cout << "0) Back\n";
 
-        int c = core::readInt("Select: ", 0, 8);
+        int c = core::readInt("Select: ", 0, 25);
         if (c == 0) return;
 
         try {
-            if (c == 1) items.push_back(buildAirSensibleItem());
-            else if (c == 2) items.push_back(buildHydronicItem());
-            else if (c == 3) items.push_back(buildConductionItem());
-            else if (c == 4) items.push_back(buildACHItem());
+            if (c == 1) addItem(buildAirSensibleItem(cfg));
+            else if (c == 2) addItem(buildHydronicItem(cfg));
+            else if (c == 3) addItem(buildConductionItem(cfg, &items.library));
+            else if (c == 4) addItem(buildACHItem(cfg));
             else if (c == 5) {
                 if (items.empty()) std::cout << "\n(No items yet.)\n";
-                else ui::printItemTable(items);
+                else ui::printItemTable(items, sys);
                 core::pause();
             }
             else if (c == 6) {
@@ -351,9 +5049,9 @@ void projectMenu(std::vector<LoadItem>& items) {
                     core::pause();
                     continue;
                 }
-                ui::printItemTable(items);
+                ui::printItemTable(items, sys);
                 int idx = core::readInt("Remove which item #? ", 1, static_cast<int>(items.size()));
-                items.erase(items.begin() + (idx - 1));
+                items.erase(static_cast<size_t>(idx - 1));
                 std::cout << "Removed.\n";
                 core::pause();
             }
@@ -365,7 +5063,7 @@ void projectMenu(std::vector<LoadItem>& items) {
                 }
                 std::string path = core::readLine("CSV file path (e.g., heat_load.csv): ");
                 if (path.empty()) path = "heat_load.csv";
-                ui::exportCSV(items, path);
+                ui::exportCSV(items, path, sys, cfg.memoize);
                 core::pause();
             }
             else if (c == 8) {
@@ -375,6 +5073,159 @@ void projectMenu(std::vector<LoadItem>& items) {
                 }
                 core::pause();
             }
+            else if (c == 9) {
+                std::string path = core::readLine("Project CSV path (Method,Name,A,B,C[,Zone,Tag]): ");
+                if (!path.empty()) io::importProjectCSV(path, cfg, items);
+                core::pause();
+            }
+            else if (c == 10) {
+                if (items.empty()) {
+                    std::cout << "\n(No items yet.)\n";
+                    core::pause();
+                    continue;
+                }
+                std::cout << "  1) By method\n  2) By zone\n  3) By tag\n";
+                int by = core::readInt("Group: ", 1, 3);
+                static const char* const titles[] = { "LOADS BY METHOD", "LOADS BY ZONE", "LOADS BY TAG" };
+                ui::printGroupSummary(query::groupBy(items, static_cast<query::GroupBy>(by - 1)), titles[by - 1], sys);
+                core::pause();
+            }
+            else if (c == 11) {
+                items.activeZone = core::readLine("Zone for new items (blank = none): ");
+                items.activeTag = core::readLine("Tag for new items (blank = none): ");
+            }
+            else if (c == 12 || c == 13) {
+                if (items.empty()) {
+                    std::cout << "\n(No items yet.)\n";
+                    core::pause();
+                    continue;
+                }
+                if (c == 12) {
+                    int n = core::readInt("How many? ", 1, static_cast<int>(std::min<size_t>(items.size(), 1000000)));
+                    ui::printSelectedRows(items, query::topN(items, static_cast<size_t>(n)),
+                        "LARGEST " + std::to_string(n) + " LOADS", sys);
+                }
+                else {
+                    units::BtuHr t = (sys == units::System::SI)
+                        ? units::kw_to_btuhr(units::Kw(core::readDouble("Threshold (kW): ", -1e15, 1e15)))
+                        : units::ton_to_btuhr(units::Tons(core::readDouble("Threshold (tons): ", -1e15, 1e15)));
+                    ui::printSelectedRows(items, query::atLeast(items, t), "LOADS AT OR ABOVE THRESHOLD", sys);
+                }
+                core::pause();
+            }
+            else if (c == 14) {
+                std::string pattern = core::readLine("Name text to find: ");
+                if (pattern.empty()) continue;
+                std::cout << "  1) Names starting with it\n  2) Names containing it\n";
+                query::NameMatch mode = (core::readInt("Match: ", 1, 2) == 1)
+                    ? query::NameMatch::Prefix : query::NameMatch::Substring;
+
+                std::vector<std::uint32_t> rows = query::findByName(items, pattern, mode);
+                if (rows.empty()) {
+                    std::cout << "\n(No matching items.)\n";
+                    core::pause();
+                    continue;
+                }
+                ui::printSelectedRows(items, rows, "MATCHES FOR \"" + pattern + "\"", sys);
+
+                std::cout << "1) Remove all matches\n";
+                std::cout << "2) Rename all matches\n";
+                std::cout << "3) Set zone/tag on all matches\n";
+                std::cout << "0) Back\n";
+                int op = core::readInt("Select: ", 0, 3);
+                if (op == 1 && core::yesNo("Remove " + std::to_string(rows.size()) + " item(s)?")) {
+                    std::vector<std::uint8_t> drop(items.size(), 0);
+                    bulk::markRows(rows, drop);
+                    std::cout << "Removed " << items.compact(drop) << " item(s).\n";
+                }
+                else if (op == 2) {
+                    std::string name = core::readLine("New name: ");
+                    if (!name.empty()) items.setName(rows, name);
+                }
+                else if (op == 3) {
+                    items.setZone(rows, core::readLine("Zone (blank = none): "));
+                    items.setTag(rows, core::readLine("Tag (blank = none): "));
+                }
+                core::pause();
+            }
+            else if (c == 15) {
+                if (items.empty()) {
+                    std::cout << "\n(No items yet.)\n";
+                    core::pause();
+                    continue;
+                }
+                std::cout << "1) Remove item # ranges (e.g., 3-10,15)\n";
+                std::cout << "2) Remove all items of a method\n";
+                std::cout << "3) Remove items whose name contains text\n";
+                std::cout << "4) Scale all ACH items by a factor\n";
+                std::cout << "0) Back\n";
+                int op = core::readInt("Select: ", 0, 4);
+                if (op == 0) continue;
+
+                std::vector<std::uint8_t> drop(items.size(), 0);
+                if (op == 1) {
+                    std::string spec = core::readLine("Item #s: ");
+                    if (!bulk::markRanges(spec, drop)) {
+                        std::cout << "  [Error] Use numbers or ranges from 1 to " << items.size() << ", comma-separated.\n";
+                        core::pause();
+                        continue;
+                    }
+                }
+                else if (op == 2) {
+                    for (int m = 0; m < calcs::METHOD_COUNT; ++m)
+                        std::cout << "  " << (m + 1) << ") " << calcs::methodLabel(static_cast<calcs::Method>(m)) << "\n";
+                    bulk::markMethod(items, static_cast<calcs::Method>(core::readInt("Method: ", 1, calcs::METHOD_COUNT) - 1), drop);
+                }
+                else if (op == 3) {
+                    std::string pattern = core::readLine("Name text: ");
+                    if (!pattern.empty())
+                        bulk::markRows(query::findByName(items, pattern, query::NameMatch::Substring), drop);
+                }
+                else if (op == 4) {
+                    std::cout << "(ACH values from formulas are replaced by the scaled number.)\n";
+                    double k = core::readDouble("ACH factor (e.g., 1.25): ", 0.0, 1e6);
+                    std::cout << "Scaled " << bulk::scaleMethod(items, calcs::Method::AchAir, k) << " ACH item(s).\n";
+                    core::pause();
+                    continue;
+                }
+
+                size_t marked = static_cast<size_t>(std::count(drop.begin(), drop.end(), std::uint8_t(1)));
+                if (marked && core::yesNo("Remove " + std::to_string(marked) + " item(s)?"))
+                    std::cout << "Removed " << items.compact(drop) << " item(s).\n";
+                else if (!marked)
+                    std::cout << "(Nothing matched.)\n";
+                core::pause();
+            }
+            else if (c == 16) {
+                assemblyMenu(items, sys);
+            }
+            else if (c == 17) {
+                std::string path = core::readLine("Surface CSV path (Surface,Name,Assembly,Orientation,dT,x,y,z,...): ");
+                if (!path.empty()) io::importSurfaces(path, items);
+                core::pause();
+            }
+            else if (c == 18) addItem(buildSolarItem(cfg));
+            else if (c == 19) addItem(buildInternalItem(cfg));
+            else if (c == 20) addItem(buildLatentItem(cfg));
+            else if (c == 21) {
+                annualEnergyMenu(items, cfg);
+                core::pause();
+            }
+            else if (c == 22) {
+                designWhatIf(items, sys);
+                core::pause();
+            }
+            else if (c == 23) {
+                sizingMenu(items, sys);
+                core::pause();
+            }
+            else if (c == 24) {
+                watchMenu(items, cfg);
+            }
+            else if (c == 25) {
+                variablesMenu(items, cfg);
+                core::pause();
+            }
         }
         catch (...) {
             std::cout << "  [Error] Unexpected issue. Inputs were not applied.\n";
@@ -383,7 +5234,7 @@ void projectMenu(std::vector<LoadItem>& items) {
     }
 }
 
-void quickCalcMenu() {
+void quickCalcMenu(const Settings& cfg) {
     while (true) {
         std::cout << "\n=============================\n";
         std::cout << " QUICK CALCS\n";
@@ -392,30 +5243,217 @@ void quickCalcMenu() {
         std::cout << "2) Hydronic (GPM, dT)\n";
         std::cout << "3) Conduction (U/R, A, dT)\n";
         std::cout << "4) ACH Air Load (Vol, ACH, dT)\n";
+        std::cout << "5) Solar Gain (SHGC, A, I)\n";
+        std::cout << "6) Internal Gain (people/lights/equip)\n";
+        std::cout << "7) Latent Air Load (CFM, dW)\n";
         std::cout << "0) Back\n";
 
-        int c = core::readInt("Select: ", 0, 4);
+        int c = core::readInt("Select: ", 0, 7);
         if (c == 0) return;
 
-        LoadItem item;
-        if (c == 1) item = buildAirSensibleItem();
-        else if (c == 2) item = buildHydronicItem();
-        else if (c == 3) item = buildConductionItem();
-        else if (c == 4) item = buildACHItem();
+        // Each branch returns the builder's prvalue, so the item is built in
+        // place rather than assigned over a default one.
+        const LoadItem item = [&cfg, c]() {
+            switch (c) {
+            case 1: return buildAirSensibleItem(cfg);
+            case 2: return buildHydronicItem(cfg);
+            case 3: return buildConductionItem(cfg);
+            case 4: return buildACHItem(cfg);
+            case 5: return buildSolarItem(cfg);
+            case 6: return buildInternalItem(cfg);
+            default: return buildLatentItem(cfg);
+            }
+        }();
 
         std::cout << "\n--- Output (Quick) ---\n";
-        std::cout << std::fixed << std::setprecision(1)
-            << "BTU/hr: " << item.btu_per_hr << "\n";
-        std::cout << std::fixed << std::setprecision(3)
-            << "kW:     " << units::btuhr_to_kw(item.btu_per_hr) << "\n"
-            << "Tons:   " << units::btuhr_to_ton(item.btu_per_hr) << "\n";
+        if (cfg.system == units::System::SI) {
+            std::cout << std::fixed << std::setprecision(1)
+                << "W:      " << units::btuhr_to_w(item.btu_per_hr) << "\n";
+            std::cout << std::fixed << std::setprecision(3)
+                << "kW:     " << units::btuhr_to_kw(item.btu_per_hr) << "\n";
+        }
+        else {
+            std::cout << std::fixed << std::setprecision(1)
+                << "BTU/hr: " << item.btu_per_hr << "\n";
+            std::cout << std::fixed << std::setprecision(3)
+                << "kW:     " << units::btuhr_to_kw(item.btu_per_hr) << "\n"
+                << "Tons:   " << units::btuhr_to_ton(item.btu_per_hr) << "\n";
+        }
         core::pause();
     }
 }
 
-int main() {
+void siteConditionsMenu(Settings& cfg) {
+    while (true) {
+        std::cout << "\n=============================\n";
+        std::cout << " SITE CONDITIONS\n";
+        std::cout << "=============================\n";
+        std::cout << std::fixed << std::setprecision(3)
+            << " Air factor:   " << cfg.airFactor << " BTU/hr per CFM·F\n"
+            << " Fluid factor: " << std::setprecision(1) << cfg.fluidFactor << " BTU/hr per GPM·F\n";
+        std::cout << "1) Set air (altitude, air temperature)\n";
+        std::cout << "2) Set hydronic fluid (type, concentration, temperature)\n";
+        std::cout << "3) Reset to standard (1.08 / 500)\n";
+        std::cout << "0) Back\n";
+
+        int c = core::readInt("Select: ", 0, 3);
+        if (c == 0) return;
+
+        const bool si = (cfg.system == units::System::SI);
+        if (c == 1) {
+            double alt = si ? core::readDouble("Site altitude (m): ", -500.0, 6000.0) * units::FT_PER_M
+                : core::readDouble("Site altitude (ft): ", -1500.0, 20000.0);
+            double t = si ? core::readDouble("Air temperature at flow measurement (C): ", -60.0, 150.0) * 1.8 + 32.0
+                : core::readDouble("Air temperature at flow measurement (F): ", -80.0, 300.0);
+            cfg.airFactor = props::air_sensible_factor(alt, units::DegF(t));
+        }
+        else if (c == 2) {
+            std::cout << "  1) Water\n  2) Propylene glycol\n  3) Ethylene glycol\n";
+            props::Fluid fluid = static_cast<props::Fluid>(core::readInt("Fluid: ", 1, props::FLUID_COUNT) - 1);
+            double pct = (fluid == props::Fluid::Water) ? 0.0 : core::readDouble("Concentration (% by volume): ", 0.0, 60.0);
+            double t = si ? core::readDouble("Mean fluid temperature (C): ", 0.0, 100.0) * 1.8 + 32.0
+                : core::readDouble("Mean fluid temperature (F): ", 32.0, 212.0);
+            cfg.fluidFactor = props::hydronic_factor(fluid, pct, units::DegF(t));
+            std::cout << props::fluidName(fluid) << " -> ";
+        }
+        else if (c == 3) {
+            cfg.airFactor = calcs::STANDARD_AIR;
+            cfg.fluidFactor = calcs::STANDARD_WATER;
+        }
+        std::cout << "Factors now " << ui::formatCoef(cfg.airFactor.value) << " (air), "
+            << ui::formatCoef(cfg.fluidFactor.value) << " (fluid).\n";
+    }
+}
+
+// Evaluates every project file in a directory with the current assembly
+// library and site factors, without touching the open project.
+void portfolioMenu(const Project& items, const Settings& cfg) {
+    std::string dir = core::readLine("Directory of project CSV files: ");
+    if (dir.empty()) return;
+    std::vector<std::string> paths = portfolio::listProjects(dir);
+    if (paths.empty()) {
+        std::cout << "  [Error] No .csv files found in: " << dir << "\n";
+        return;
+    }
+
+    portfolio::Options opt;
+    opt.memoize = cfg.memoize;
+    opt.outDir = core::readLine("Output directory for per-project CSVs (blank to skip): ");
+    opt.cacheDir = core::readLine("Result cache directory (blank for none): ");
+    std::error_code ec;
+    if (!opt.outDir.empty() && std::filesystem::weakly_canonical(opt.outDir, ec) == std::filesystem::weakly_canonical(dir, ec)) {
+        std::cout << "  [Error] Output directory must differ from the project directory.\n";
+        return;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<portfolio::Result> results = portfolio::evaluate(paths, items.library, cfg, opt);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    numeric::CompensatedSum total;
+    std::size_t itemCount = 0, skipped = 0, failed = 0, cached = 0;
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const portfolio::Result& r = results[i];
+        if (!r.ok) {
+            if (failed++ < 5) std::cout << "  ***Error*** Could not read file: " << r.path << "\n";
+            continue;
+        }
+        total.add(r.total.value);
+        itemCount += r.items;
+        skipped += r.skipped;
+        cached += r.cached;
+        order.push_back(i);
+    }
+
+    std::cout << "\n  Evaluated " << order.size() << " project(s), " << itemCount << " item(s) in "
+        << std::fixed << std::setprecision(2) << seconds << " s.\n";
+    if (!opt.cacheDir.empty()) std::cout << "  " << cached << " project(s) unchanged since the last run, taken from the cache.\n";
+    if (failed) std::cout << "  [Warning] " << failed << " file(s) could not be read.\n";
+    if (skipped) std::cout << "  [Warning] Skipped " << skipped << " malformed row(s) in total.\n";
+
+    const std::size_t shown = std::min<std::size_t>(order.size(), 10);
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(),
+        [&results](std::size_t x, std::size_t y) { return results[x].total > results[y].total; });
+    const bool si = (cfg.system == units::System::SI);
+    std::cout << "\n------------------ LARGEST PROJECTS ------------------\n";
+    std::cout << std::left << std::setw(36) << "Project" << std::right << std::setw(10) << "Items";
+    if (si) std::cout << std::setw(14) << "W" << std::setw(12) << "kW";
+    else std::cout << std::setw(14) << "BTU/hr" << std::setw(12) << "kW" << std::setw(10) << "Tons";
+    std::cout << "\n" << std::string(si ? 72 : 82, '-') << "\n";
+    for (std::size_t k = 0; k < shown; ++k) {
+        const portfolio::Result& r = results[order[k]];
+        std::string file = std::filesystem::path(r.path).filename().string();
+        std::cout << std::left << std::setw(36) << file.substr(0, 35) << std::right << std::setw(10) << r.items;
+        ui::printLoadColumns(std::cout, r.total, cfg.system);
+        std::cout << "\n";
+    }
+    ui::printTableFooter("PORTFOLIO TOTAL:", units::BtuHr(total.result()), cfg.system);
+
+    std::string out = core::readLine("Report CSV path (blank to skip): ");
+    if (!out.empty()) portfolio::exportCSV(results, out, cfg.system);
+}
+
+// Record/replay controls. Their own prompts stay out of the script: the
+// main-menu choice that got here is dropped and recording is held off
+// while the menu runs.
+void macroMenu() {
+    core::Macro& m = core::macro();
+    const bool wasRecording = m.recording;
+    m.recording = false;
+
+    std::cout << "\n=============================\n";
+    std::cout << " MACROS\n";
+    std::cout << "=============================\n";
+    if (wasRecording) std::cout << "1) Stop Recording (saves " << m.recordPath << ")\n";
+    else std::cout << "1) Record Session\n";
+    std::cout << "2) Replay Script\n";
+    std::cout << "0) Back\n";
+
+    int c = core::readInt("Select: ", 0, 2);
+    if (c == 1 && wasRecording) {
+        core::saveRecording();
+        return;
+    }
+    if (c == 1) {
+        std::string path = core::readLine("Script path to record to (e.g., session.hlm): ");
+        if (path.empty()) return;
+        m.recordPath = path;
+        m.recorded.clear();
+        m.lastStep = 0;
+        m.recording = true;
+        std::cout << "  Recording. Open Macros again to stop and save.\n";
+        return;
+    }
+    if (c == 2) {
+        if (m.replaying) std::cout << "  [Error] A script is already replaying.\n";
+        else {
+            std::string path = core::readLine("Script path: ");
+            if (!path.empty()) {
+                bool show = core::yesNo("Show menus and results while replaying");
+                m.recording = wasRecording;
+                core::startReplay(path, show);
+                return;
+            }
+        }
+    }
+    m.recording = wasRecording;
+}
+
+#ifndef HEATLOADS_NO_MAIN
+int main(int argc, char* argv[]) {
+    Settings settings;
+    if (argc == 2 && std::string_view(argv[1]) == "--json") {
+        api::serve(settings);
+        return 0;
+    }
+
     ui::printHeader();
-    std::vector<LoadItem> projectItems;
+    Project projectItems;
+
+    // heatloads --replay session.hlm: run a recorded script without a
+    // keyboard, output muted.
+    if (argc == 3 && std::string_view(argv[1]) == "--replay" && !core::startReplay(argv[2], false, true)) return 1;
 
     while (true) {
         std::cout << "\n=============================\n";
@@ -424,21 +5462,43 @@ int main() {
         std::cout << "1) Quick Calcs\n";
         std::cout << "2) Project Mode (Add + Sum)\n";
         std::cout << "3) Conversions\n";
+        std::cout << "4) Unit System (now: " << units::systemName(settings.system) << ")\n";
+        std::cout << "5) Site Conditions (air/fluid factors)\n";
+        std::cout << "6) Portfolio (directory of projects)\n";
+        std::cout << "7) Output Cache (now: " << (settings.memoize ? "On" : "Off") << ")\n";
+        std::cout << "8) Macros (now: " << (core::macro().recording ? "Recording" : "Off") << ")\n";
         std::cout << "0) Exit\n";
 
-        int choice = core::readInt("Select: ", 0, 3);
-        if (choice == 0) {
-            std::cout << "\nGoodbye.\n";
-            return 0;
-        }
+        int choice = core::readInt("Select: ", 0, 8);
+        if (choice == 0) core::quit();
         else if (choice == 1) {
-            quickCalcMenu();
+            quickCalcMenu(settings);
         }
         else if (choice == 2) {
-            projectMenu(projectItems);
+            projectMenu(projectItems, settings);
         }
         else if (choice == 3) {
             conversionsMenu();
         }
+        else if (choice == 4) {
+            settings.system = (settings.system == units::System::SI) ? units::System::Imperial : units::System::SI;
+            std::cout << "Unit system: " << units::systemName(settings.system) << "\n";
+        }
+        else if (choice == 5) {
+            siteConditionsMenu(settings);
+        }
+        else if (choice == 6) {
+            portfolioMenu(projectItems, settings);
+            core::pause();
+        }
+        else if (choice == 7) {
+            settings.memoize = !settings.memoize;
+            std::cout << "Output cache: " << (settings.memoize ? "On" : "Off") << "\n";
+        }
+        else if (choice == 8) {
+            core::unrecordLast();
+            macroMenu();
+        }
     }
 }
+#endif // HEATLOADS_NO_MAIN
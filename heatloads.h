@@ -0,0 +1,95 @@
+/*
+ * C interface to the heat load calculation core, for callers in other
+ * languages (ctypes, cffi, Rust FFI, ...). Build it as a library with e.g.
+ *
+ *   g++ -std=c++17 -O2 -fPIC -shared -pthread -DHEATLOADS_NO_MAIN heatloads.cpp -o libheatloads.so
+ *
+ * Every function returns normally: a C++ exception never crosses this
+ * boundary. Functions returning int give HL_OK or a negative hl_status, and
+ * hl_last_error() describes the last failure on the calling thread.
+ *
+ * Inputs and loads are imperial, in the calculation core's batch layout,
+ * with c = 1 for the two-input methods:
+ *   HL_AIR_SENSIBLE  a = CFM   b = dT (F)       c = 1
+ *   HL_HYDRONIC      a = GPM   b = dT (F)       c = 1
+ *   HL_CONDUCTION    a = U     b = area (ft^2)  c = dT (F)
+ *   HL_ACH           a = ACH   b = volume (ft^3) c = dT (F)
+ *   HL_SOLAR         a = SHGC  b = area (ft^2)  c = irradiance (BTU/hr·ft^2)
+ *   HL_INTERNAL      a = count b = BTU/hr each  c = diversity
+ *   HL_LATENT        a = CFM   b = dW (lb/lb)   c = 1
+ * Loads are BTU/hr at standard air and water factors.
+ */
+#ifndef HEATLOADS_H
+#define HEATLOADS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HL_API_VERSION 1
+
+typedef enum hl_method {
+    HL_AIR_SENSIBLE = 0,
+    HL_HYDRONIC = 1,
+    HL_CONDUCTION = 2,
+    HL_ACH = 3,
+    HL_SOLAR = 4,
+    HL_INTERNAL = 5,
+    HL_LATENT = 6
+} hl_method;
+
+typedef enum hl_status {
+    HL_OK = 0,
+    HL_EINVAL = -1,   /* bad argument: unknown method, null pointer */
+    HL_EIO = -2,      /* file could not be written */
+    HL_ENOMEM = -3,
+    HL_EINTERNAL = -4
+} hl_status;
+
+typedef struct hl_project hl_project;
+
+int hl_api_version(void);
+
+/* Message for the last failure on this thread; "" if none. */
+const char* hl_last_error(void);
+
+/* out[i] = load of one method for inputs a[i], b[i] (c = 1). */
+int hl_eval_batch(int method, const double* a, const double* b, double* out, size_t n);
+
+/* As hl_eval_batch with a third input; c may be NULL for c = 1, and is
+ * ignored for the two-input methods (air sensible, hydronic, latent). */
+int hl_eval_batch3(int method, const double* a, const double* b, const double* c, double* out, size_t n);
+
+/* BTU/hr to kW or refrigeration tons, element by element; in place is fine.
+ * NULL arrays with n > 0 give HL_EINVAL. */
+int hl_btuhr_to_kw(const double* btuhr, double* out, size_t n);
+int hl_btuhr_to_tons(const double* btuhr, double* out, size_t n);
+
+/* NULL if out of memory. */
+hl_project* hl_project_create(void);
+void hl_project_destroy(hl_project* p);
+
+/* Evaluates and appends one item; a NULL or empty name gets the method's
+ * default ("AirSens Load", ...). c is ignored for the two-input methods. */
+int hl_project_add(hl_project* p, const char* name, int method, double a, double b, double c);
+
+/* Appends n items of one method; names and c may be NULL, as may any
+ * names[i]. */
+int hl_project_add_batch(hl_project* p, int method, const char* const* names,
+    const double* a, const double* b, const double* c, size_t n);
+
+size_t hl_project_size(const hl_project* p);
+
+/* Project total in BTU/hr. */
+int hl_project_total(const hl_project* p, double* btuhr);
+
+/* Writes the same loads CSV as the console export; si != 0 for W/kW. */
+int hl_project_export_csv(const hl_project* p, const char* path, int si);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEATLOADS_H */